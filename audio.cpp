@@ -0,0 +1,500 @@
+#include <cstdio>
+#include <cstring>
+#ifndef HEADLESS
+#include <irrKlang.h>
+#endif
+#include "audio.h"
+
+const char* audio_sound_paths[AUDIO_SOUND_COUNT] = {
+	"audio/explosion.wav",
+	"audio/invader_killed.wav",
+	"audio/move1.wav",
+	"audio/move2.wav",
+	"audio/move3.wav",
+	"audio/move4.wav",
+	"audio/player_shoot.wav",
+	"audio/ufo_highpitch.wav",
+	"audio/ufo_lowpitch.wav"
+};
+
+static uint32_t wav_u32(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t wav_u16(const uint8_t* p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+bool audio_load_wav(AudioClip* clip, const char* path)
+{
+	clip->samples = NULL;
+	clip->num_frames = 0;
+	clip->owned = false;
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		fprintf(stderr, "Error: could not open %s\n", path);
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t* data = new uint8_t[size > 0 ? size : 1];
+	bool ok = size >= 12 && fread(data, 1, size, file) == (size_t)size &&
+		memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WAVE", 4) == 0;
+	fclose(file);
+
+	// Walk the chunks for the format and the samples
+	uint16_t channels = 0, bits = 0;
+	const uint8_t* pcm = NULL;
+	size_t pcm_size = 0;
+	for (size_t pos = 12; ok && pos + 8 <= (size_t)size; )
+	{
+		uint32_t chunk = wav_u32(data + pos + 4);
+		const uint8_t* body = data + pos + 8;
+		if (chunk > (size_t)size - pos - 8)
+			chunk = uint32_t(size - pos - 8);
+		if (memcmp(data + pos, "fmt ", 4) == 0 && chunk >= 16)
+		{
+			ok = wav_u16(body) == 1; // Uncompressed PCM only
+			channels = wav_u16(body + 2);
+			clip->sample_rate = wav_u32(body + 4);
+			bits = wav_u16(body + 14);
+		}
+		else if (memcmp(data + pos, "data", 4) == 0)
+		{
+			pcm = body;
+			pcm_size = chunk;
+		}
+		pos += 8 + chunk + (chunk & 1);
+	}
+
+	ok = ok && pcm && (channels == 1 || channels == 2) && (bits == 8 || bits == 16);
+	if (!ok)
+	{
+		fprintf(stderr, "Error: %s is not an 8 or 16-bit PCM WAV\n", path);
+		delete[] data;
+		return false;
+	}
+
+	size_t bytes = bits / 8;
+	clip->num_frames = pcm_size / (bytes * channels);
+	int16_t* samples = new int16_t[clip->num_frames ? clip->num_frames : 1];
+	for (size_t i = 0; i < clip->num_frames; ++i)
+	{
+		int sum = 0;
+		for (size_t c = 0; c < channels; ++c)
+		{
+			const uint8_t* s = pcm + (i * channels + c) * bytes;
+			sum += bits == 8 ? (s[0] - 128) * 256 : (int16_t)wav_u16(s);
+		}
+		samples[i] = (int16_t)(sum / channels);
+	}
+	clip->samples = samples;
+	clip->owned = true;
+	delete[] data;
+	return true;
+}
+
+void audio_clip_free(AudioClip* clip)
+{
+	if (clip->owned)
+		delete[] clip->samples;
+	clip->samples = NULL;
+	clip->owned = false;
+	clip->num_frames = 0;
+}
+
+void audio_queue_init(AudioQueue* queue)
+{
+	queue->head = 0;
+	queue->tail = 0;
+}
+
+bool audio_queue_push(AudioQueue* queue, AudioSound sound)
+{
+	uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+	if (tail - queue->head.load(std::memory_order_acquire) == AUDIO_QUEUE_SIZE)
+		return false;
+	queue->sounds[tail % AUDIO_QUEUE_SIZE] = (uint8_t)sound;
+	queue->tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+bool audio_queue_pop(AudioQueue* queue, AudioSound* sound)
+{
+	uint32_t head = queue->head.load(std::memory_order_relaxed);
+	if (head == queue->tail.load(std::memory_order_acquire))
+		return false;
+	*sound = (AudioSound)queue->sounds[head % AUDIO_QUEUE_SIZE];
+	queue->head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+// A finished voice if there is one, otherwise the oldest
+static AudioVoice& audio_voice_take(Audio* audio)
+{
+	AudioVoice* oldest = &audio->voices[0];
+	for (size_t i = 0; i < AUDIO_MAX_VOICES; ++i)
+	{
+		AudioVoice& voice = audio->voices[i];
+		if (voice.sound < 0 || !audio->backend->playing(audio, voice))
+			return voice;
+		if (voice.serial < oldest->serial)
+			oldest = &voice;
+	}
+	return *oldest;
+}
+
+static void audio_voice_stop(Audio* audio, AudioVoice& voice)
+{
+	if (voice.sound >= 0)
+		audio->backend->stop(audio, voice);
+	voice.sound = -1;
+	voice.handle = NULL;
+}
+
+static void audio_start_queued(Audio* audio)
+{
+	AudioSound sound;
+	while (audio_queue_pop(&audio->queue, &sound))
+	{
+		AudioVoice& voice = audio_voice_take(audio);
+		audio_voice_stop(audio, voice);
+		voice.sound = sound;
+		voice.serial = audio->serial++;
+		voice.position = 0;
+		audio->backend->start(audio, voice);
+	}
+}
+
+// Starts queued sounds whenever woken, until audio_free
+static void audio_thread(Audio* audio)
+{
+	std::unique_lock<std::mutex> lock(audio->mutex);
+	while (audio->running.load(std::memory_order_relaxed))
+	{
+		lock.unlock();
+		audio_start_queued(audio);
+		lock.lock();
+		// Checked under the lock that audio_advance takes before notifying,
+		// so a push between the check and the wait cannot be missed
+		while (audio->running.load(std::memory_order_relaxed) && audio_queue_empty(&audio->queue))
+			audio->wake.wait(lock);
+	}
+}
+
+void audio_advance(Audio* audio)
+{
+	if (!audio)
+		return;
+	if (audio->backend->threaded)
+	{
+		// One wake per tick that played something, not one per sound
+		if (!audio_queue_empty(&audio->queue))
+		{
+			{
+				std::lock_guard<std::mutex> lock(audio->mutex);
+			}
+			audio->wake.notify_one();
+		}
+		return;
+	}
+	audio_start_queued(audio);
+	if (audio->backend->advance)
+		audio->backend->advance(audio);
+}
+
+bool audio_load_clips(Audio* audio)
+{
+	bool ok = true;
+	for (size_t i = 0; i < AUDIO_SOUND_COUNT; ++i)
+	{
+		AudioClip& clip = audio->clips[i];
+		audio_clip_free(&clip);
+		BundleItem item;
+		if (audio->bundle && bundle_find(audio->bundle, audio_sound_paths[i], BUNDLE_PCM, &item))
+		{
+			clip.samples = (const int16_t*)item.data;
+			clip.num_frames = item.size / sizeof(int16_t);
+			clip.sample_rate = item.a;
+			continue;
+		}
+		ok = audio_load_wav(&clip, audio_sound_paths[i]) && ok;
+	}
+
+	// The mixers play every clip at one rate
+	for (size_t i = 0; ok && i < AUDIO_SOUND_COUNT; ++i)
+	{
+		if (audio->clips[i].sample_rate == 0 || audio->clips[i].sample_rate != audio->clips[0].sample_rate)
+		{
+			fprintf(stderr, "Error: %s has a sample rate of %u Hz, expected %u Hz\n", audio_sound_paths[i],
+				audio->clips[i].sample_rate, audio->clips[0].sample_rate);
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+bool audio_init(Audio* audio, const AudioBackend& backend, const char* output_path, const Bundle* bundle)
+{
+	audio->backend = &backend;
+	audio->backend_data = NULL;
+	audio->output_path = output_path;
+	audio->bundle = bundle;
+	audio->serial = 0;
+	audio->running = false;
+	audio_queue_init(&audio->queue);
+	for (size_t i = 0; i < AUDIO_SOUND_COUNT; ++i)
+	{
+		audio->clips[i].samples = NULL;
+		audio->clips[i].num_frames = 0;
+		audio->clips[i].owned = false;
+	}
+	for (size_t i = 0; i < AUDIO_MAX_VOICES; ++i)
+	{
+		audio->voices[i].sound = -1;
+		audio->voices[i].serial = 0;
+		audio->voices[i].handle = NULL;
+		audio->voices[i].position = 0;
+	}
+
+	if (!backend.open(audio))
+	{
+		audio->backend = &audio_backend_null;
+		return false;
+	}
+	if (backend.threaded)
+	{
+		audio->running = true;
+		audio->thread = std::thread(audio_thread, audio);
+	}
+	return true;
+}
+
+void audio_free(Audio* audio)
+{
+	if (audio->running)
+	{
+		{
+			std::lock_guard<std::mutex> lock(audio->mutex);
+			audio->running = false;
+		}
+		audio->wake.notify_one();
+		audio->thread.join();
+	}
+	for (size_t i = 0; i < AUDIO_MAX_VOICES; ++i)
+		audio_voice_stop(audio, audio->voices[i]);
+	audio->backend->close(audio);
+	audio->backend = &audio_backend_null;
+	for (size_t i = 0; i < AUDIO_SOUND_COUNT; ++i)
+		audio_clip_free(&audio->clips[i]);
+}
+
+// Null backend
+
+static bool null_open(Audio* audio) { return true; }
+static void null_close(Audio* audio) {}
+static void null_start(Audio* audio, AudioVoice& voice) {}
+static bool null_playing(Audio* audio, const AudioVoice& voice) { return false; }
+static void null_stop(Audio* audio, AudioVoice& voice) {}
+
+const AudioBackend audio_backend_null = {
+	"null", false, null_open, null_close, null_start, null_playing, null_stop, NULL
+};
+
+// Offline backend: every tick mixes 1/60 s of the playing voices at the
+// clips' sample rate, clamps to 16 bits and appends it to a WAV file
+
+#define AUDIO_MIX_MAX_FRAMES 1024
+
+struct OfflineMixer
+{
+	FILE* file;
+	uint32_t sample_rate;
+	uint32_t remainder; // Sample rate / 60 carried over between ticks
+	uint64_t frames;
+	bool failed; // A write came up short, reported on close
+	int32_t mix[AUDIO_MIX_MAX_FRAMES];
+	uint8_t bytes[AUDIO_MIX_MAX_FRAMES * 2];
+};
+
+static bool offline_write_header(OfflineMixer* mixer)
+{
+	uint32_t data_size = uint32_t(mixer->frames * 2);
+	uint8_t h[44];
+	memcpy(h, "RIFF", 4);
+	uint32_t fields[] = { 36 + data_size, 0, 0, 16, 0, mixer->sample_rate, mixer->sample_rate * 2, 0, 0, data_size };
+	for (size_t i = 0; i < 10; ++i)
+		for (size_t b = 0; b < 4; ++b)
+			h[4 + i * 4 + b] = uint8_t(fields[i] >> (8 * b));
+	memcpy(h + 8, "WAVE", 4);
+	memcpy(h + 12, "fmt ", 4);
+	h[20] = 1; h[21] = 0; // PCM
+	h[22] = 1; h[23] = 0; // Mono
+	h[32] = 2; h[33] = 0; // Block align
+	h[34] = 16; h[35] = 0; // Bits per sample
+	memcpy(h + 36, "data", 4);
+	return fseek(mixer->file, 0, SEEK_SET) == 0 && fwrite(h, 1, sizeof(h), mixer->file) == sizeof(h);
+}
+
+static bool offline_open(Audio* audio)
+{
+	if (!audio->output_path || !audio_load_clips(audio))
+		return false;
+	OfflineMixer* mixer = new OfflineMixer;
+	mixer->file = fopen(audio->output_path, "wb");
+	mixer->sample_rate = audio->clips[0].sample_rate;
+	mixer->remainder = 0;
+	mixer->frames = 0;
+	mixer->failed = false;
+	if (!mixer->file || !offline_write_header(mixer))
+	{
+		fprintf(stderr, "Error: could not create %s\n", audio->output_path);
+		if (mixer->file) fclose(mixer->file);
+		delete mixer;
+		return false;
+	}
+	audio->backend_data = mixer;
+	return true;
+}
+
+static void offline_close(Audio* audio)
+{
+	OfflineMixer* mixer = (OfflineMixer*)audio->backend_data;
+	if (!mixer) return;
+	// Patch in the final length, which after a failed write covers only
+	// what was written before it
+	bool ok = offline_write_header(mixer);
+	ok = fclose(mixer->file) == 0 && ok;
+	if (!ok || mixer->failed)
+		fprintf(stderr, "Error: could not write %s, it is incomplete\n", audio->output_path);
+	delete mixer;
+	audio->backend_data = NULL;
+}
+
+static void offline_start(Audio* audio, AudioVoice& voice) {}
+
+static bool offline_playing(Audio* audio, const AudioVoice& voice)
+{
+	return (voice.position >> 16) < audio->clips[voice.sound].num_frames;
+}
+
+static void offline_stop(Audio* audio, AudioVoice& voice) {}
+
+static void offline_advance(Audio* audio)
+{
+	OfflineMixer* mixer = (OfflineMixer*)audio->backend_data;
+	mixer->remainder += mixer->sample_rate;
+	size_t frames = mixer->remainder / 60;
+	mixer->remainder %= 60;
+	if (frames > AUDIO_MIX_MAX_FRAMES)
+		frames = AUDIO_MIX_MAX_FRAMES;
+
+	memset(mixer->mix, 0, frames * sizeof(int32_t));
+	for (size_t v = 0; v < AUDIO_MAX_VOICES; ++v)
+	{
+		AudioVoice& voice = audio->voices[v];
+		if (voice.sound < 0) continue;
+		const AudioClip& clip = audio->clips[voice.sound];
+		uint64_t step = ((uint64_t)clip.sample_rate << 16) / mixer->sample_rate;
+		for (size_t i = 0; i < frames && (voice.position >> 16) < clip.num_frames; ++i)
+		{
+			mixer->mix[i] += clip.samples[voice.position >> 16];
+			voice.position += step;
+		}
+	}
+
+	for (size_t i = 0; i < frames; ++i)
+	{
+		int32_t sample = mixer->mix[i] < -32768 ? -32768 : (mixer->mix[i] > 32767 ? 32767 : mixer->mix[i]);
+		mixer->bytes[i * 2] = uint8_t(sample);
+		mixer->bytes[i * 2 + 1] = uint8_t(sample >> 8);
+	}
+	if (mixer->failed)
+		return;
+	if (fwrite(mixer->bytes, 2, frames, mixer->file) != frames)
+	{
+		fprintf(stderr, "Error: could not write %s, stopping the audio output\n", audio->output_path);
+		mixer->failed = true;
+		return;
+	}
+	mixer->frames += frames;
+}
+
+const AudioBackend audio_backend_offline = {
+	"offline", false, offline_open, offline_close, offline_start, offline_playing, offline_stop, offline_advance
+};
+
+#ifndef HEADLESS
+// irrKlang backend, the decoded clips are registered as sound sources so
+// starting a voice never touches a file
+
+struct IrrKlangDevice
+{
+	irrklang::ISoundEngine* engine;
+	irrklang::ISoundSource* sources[AUDIO_SOUND_COUNT];
+};
+
+static bool irrklang_open(Audio* audio)
+{
+	if (!audio_load_clips(audio))
+		return false;
+	irrklang::ISoundEngine* engine = irrklang::createIrrKlangDevice();
+	if (!engine)
+	{
+		fprintf(stderr, "Error: could not open a sound device\n");
+		return false;
+	}
+
+	IrrKlangDevice* device = new IrrKlangDevice;
+	device->engine = engine;
+	for (size_t i = 0; i < AUDIO_SOUND_COUNT; ++i)
+	{
+		const AudioClip& clip = audio->clips[i];
+		irrklang::SAudioStreamFormat format;
+		format.ChannelCount = 1;
+		format.FrameCount = (irrklang::ik_s32)clip.num_frames;
+		format.SampleRate = (irrklang::ik_s32)clip.sample_rate;
+		format.SampleFormat = irrklang::ESF_S16;
+		device->sources[i] = engine->addSoundSourceFromPCMData((void*)clip.samples,
+			(irrklang::ik_s32)(clip.num_frames * sizeof(int16_t)), audio_sound_paths[i], format, false);
+	}
+	audio->backend_data = device;
+	return true;
+}
+
+static void irrklang_close(Audio* audio)
+{
+	IrrKlangDevice* device = (IrrKlangDevice*)audio->backend_data;
+	if (!device) return;
+	device->engine->drop();
+	delete device;
+	audio->backend_data = NULL;
+}
+
+static void irrklang_start(Audio* audio, AudioVoice& voice)
+{
+	IrrKlangDevice* device = (IrrKlangDevice*)audio->backend_data;
+	voice.handle = device->engine->play2D(device->sources[voice.sound], false, false, true);
+}
+
+static bool irrklang_playing(Audio* audio, const AudioVoice& voice)
+{
+	return voice.handle && !((irrklang::ISound*)voice.handle)->isFinished();
+}
+
+static void irrklang_stop(Audio* audio, AudioVoice& voice)
+{
+	irrklang::ISound* sound = (irrklang::ISound*)voice.handle;
+	if (!sound) return;
+	sound->stop();
+	sound->drop();
+}
+
+const AudioBackend audio_backend_irrklang = {
+	"irrklang", true, irrklang_open, irrklang_close, irrklang_start, irrklang_playing, irrklang_stop, NULL
+};
+#endif
@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "bundle.h"
+
+// Every sound the game plays, decoded once by audio_init
+enum AudioSound
+{
+	AUDIO_EXPLOSION,
+	AUDIO_INVADER_KILLED,
+	AUDIO_MOVE1,
+	AUDIO_MOVE2,
+	AUDIO_MOVE3,
+	AUDIO_MOVE4,
+	AUDIO_PLAYER_SHOOT,
+	AUDIO_UFO_HIGHPITCH,
+	AUDIO_UFO_LOWPITCH,
+	AUDIO_SOUND_COUNT
+};
+
+extern const char* audio_sound_paths[AUDIO_SOUND_COUNT];
+
+// Mono 16-bit PCM
+struct AudioClip
+{
+	const int16_t* samples;
+	size_t num_frames;
+	uint32_t sample_rate;
+	bool owned; // Decoded into the heap, rather than pointing into a bundle
+};
+
+// Reads an uncompressed 8 or 16-bit WAV, mixing stereo down to mono
+bool audio_load_wav(AudioClip* clip, const char* path);
+void audio_clip_free(AudioClip* clip);
+
+// Single producer, single consumer ring of sounds to start. Pushing never
+// blocks or allocates; when the ring is full the sound is dropped.
+#define AUDIO_QUEUE_SIZE 256
+
+struct AudioQueue
+{
+	uint8_t sounds[AUDIO_QUEUE_SIZE];
+	std::atomic<uint32_t> head; // Next slot to read, owned by the consumer
+	std::atomic<uint32_t> tail; // Next slot to write, owned by the producer
+};
+
+void audio_queue_init(AudioQueue* queue);
+bool audio_queue_push(AudioQueue* queue, AudioSound sound);
+bool audio_queue_pop(AudioQueue* queue, AudioSound* sound);
+inline bool audio_queue_empty(const AudioQueue* queue)
+{
+	return queue->head.load(std::memory_order_acquire) == queue->tail.load(std::memory_order_acquire);
+}
+
+// Playing sounds. When every voice is busy the oldest one is cut off.
+#define AUDIO_MAX_VOICES 16
+
+struct AudioVoice
+{
+	int sound; // -1 when free
+	uint64_t serial; // Start order, the smallest is stolen first
+	void* handle; // Backend sound
+	uint64_t position; // Software mixer read position, 16.16 fixed point
+};
+
+struct Audio;
+
+// Where sounds end up. Threaded backends start voices on the audio thread
+// as commands arrive; the others are driven one tick at a time by
+// audio_advance, so their output depends only on the game's events.
+struct AudioBackend
+{
+	const char* name;
+	bool threaded;
+	bool (*open)(Audio* audio);
+	void (*close)(Audio* audio);
+	void (*start)(Audio* audio, AudioVoice& voice);
+	bool (*playing)(Audio* audio, const AudioVoice& voice);
+	void (*stop)(Audio* audio, AudioVoice& voice);
+	// Produce one tick (1/60 s) of output, may be NULL
+	void (*advance)(Audio* audio);
+};
+
+// Discards every sound
+extern const AudioBackend audio_backend_null;
+// Mixes in software and writes 16-bit mono to a WAV file
+extern const AudioBackend audio_backend_offline;
+#ifndef HEADLESS
+// Plays through irrKlang on the default sound device
+extern const AudioBackend audio_backend_irrklang;
+#endif
+
+struct Audio
+{
+	const AudioBackend* backend;
+	void* backend_data;
+	const char* output_path; // For the offline backend
+	const Bundle* bundle; // Where clips come from, loose WAVs when NULL
+	AudioClip clips[AUDIO_SOUND_COUNT];
+	AudioVoice voices[AUDIO_MAX_VOICES];
+	uint64_t serial;
+	AudioQueue queue;
+	// The audio thread sleeps on wake until audio_advance queued sounds
+	// or audio_free stops it. The sounds themselves stay in the ring.
+	std::atomic<bool> running;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::thread thread;
+};
+
+// Opens the backend, and starts the audio thread for threaded ones.
+// Returns false if the backend could not be opened, for example without
+// a sound device or with a clip missing. Call audio_free either way.
+bool audio_init(Audio* audio, const AudioBackend& backend, const char* output_path = NULL,
+	const Bundle* bundle = NULL);
+void audio_free(Audio* audio);
+
+// Every clip in audio_sound_paths, for backends that need samples. Taken
+// from the bundle without copying when it has them, otherwise decoded
+// from the WAV files.
+bool audio_load_clips(Audio* audio);
+
+// Called from the simulation thread, safe for one thread at a time
+inline void audio_play(Audio* audio, AudioSound sound)
+{
+	if (audio)
+		audio_queue_push(&audio->queue, sound);
+}
+
+// Called by the simulation after every tick's audio_play calls. Starts
+// the tick's sounds and produces its output on non-threaded backends,
+// and wakes the audio thread for the tick's sounds on threaded ones.
+void audio_advance(Audio* audio);
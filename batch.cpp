@@ -0,0 +1,135 @@
+#include "batch.h"
+
+#define BATCH_CHUNK_SIZE 16
+
+static void batch_run_chunk(BatchSim* batch, size_t chunk)
+{
+	size_t begin = chunk * batch->chunk_size;
+	size_t end = begin + batch->chunk_size;
+	if (end > batch->num_games) end = batch->num_games;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		Game& game = batch->games[i];
+		Input& input = batch->inputs[i];
+		for (size_t t = 0; t < batch->ticks; ++t)
+		{
+			if (batch->policy)
+				batch->policy(i, game, input, batch->policy_user);
+			game_step(game, input);
+		}
+	}
+}
+
+static void batch_run_queues(BatchSim* batch, size_t id)
+{
+	// Drain our own queue first, then steal from the others
+	for (size_t k = 0; k < batch->num_threads; ++k)
+	{
+		BatchQueue& queue = batch->queues[(id + k) % batch->num_threads];
+		for (;;)
+		{
+			size_t chunk = queue.next.fetch_add(1, std::memory_order_relaxed);
+			if (chunk >= queue.end) break;
+			batch_run_chunk(batch, chunk);
+		}
+	}
+}
+
+static void batch_worker(BatchSim* batch, size_t id)
+{
+	size_t seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(batch->mutex);
+			while (!batch->quit && batch->generation == seen)
+				batch->start_cv.wait(lock);
+			if (batch->quit) return;
+			seen = batch->generation;
+		}
+
+		batch_run_queues(batch, id);
+
+		{
+			std::lock_guard<std::mutex> lock(batch->mutex);
+			if (--batch->pending == 0)
+				batch->done_cv.notify_one();
+		}
+	}
+}
+
+void batch_init(BatchSim* batch, size_t num_games, size_t width, size_t height, uint32_t seed, size_t num_threads)
+{
+	if (num_threads == 0)
+		num_threads = std::thread::hardware_concurrency();
+	if (num_threads == 0)
+		num_threads = 1;
+
+	batch->num_games = num_games;
+	batch->games = new Game[num_games];
+	batch->inputs = new Input[num_games];
+
+	// Game i draws from PCG stream i, game 0 matches a single game
+	for (size_t i = 0; i < num_games; ++i)
+	{
+		game_init(batch->games[i], width, height, seed);
+		rng_seed(&batch->games[i].rng, seed, i);
+		batch->inputs[i] = Input();
+	}
+
+	batch->policy = NULL;
+	batch->policy_user = NULL;
+
+	batch->num_threads = num_threads;
+	batch->chunk_size = BATCH_CHUNK_SIZE;
+	batch->queues = new BatchQueue[num_threads];
+	for (size_t t = 0; t < num_threads; ++t)
+	{
+		batch->queues[t].next = 0;
+		batch->queues[t].end = 0;
+	}
+
+	batch->generation = 0;
+	batch->pending = 0;
+	batch->ticks = 0;
+	batch->quit = false;
+
+	for (size_t t = 0; t < num_threads; ++t)
+		batch->workers.push_back(std::thread(batch_worker, batch, t));
+}
+
+void batch_step(BatchSim* batch, size_t ticks)
+{
+	size_t num_chunks = (batch->num_games + batch->chunk_size - 1) / batch->chunk_size;
+
+	std::unique_lock<std::mutex> lock(batch->mutex);
+	for (size_t t = 0; t < batch->num_threads; ++t)
+	{
+		batch->queues[t].next = t * num_chunks / batch->num_threads;
+		batch->queues[t].end = (t + 1) * num_chunks / batch->num_threads;
+	}
+	batch->ticks = ticks;
+	batch->pending = batch->num_threads;
+	++batch->generation;
+	batch->start_cv.notify_all();
+
+	while (batch->pending > 0)
+		batch->done_cv.wait(lock);
+}
+
+void batch_free(BatchSim* batch)
+{
+	{
+		std::lock_guard<std::mutex> lock(batch->mutex);
+		batch->quit = true;
+	}
+	batch->start_cv.notify_all();
+	for (size_t t = 0; t < batch->workers.size(); ++t)
+		batch->workers[t].join();
+	batch->workers.clear();
+
+	delete[] batch->queues;
+	delete[] batch->inputs;
+	delete[] batch->games;
+}
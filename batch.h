@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "game.h"
+
+// Fills in the input of game `index` before each of its ticks
+typedef void (*BatchPolicy)(size_t index, const Game& game, Input& input, void* user);
+
+// Chunks in [next, end) are still unclaimed. The owning worker and any
+// thief both claim with fetch_add on next, so every chunk runs once.
+// Padded to a cache line so workers don't fight over each other's queue.
+struct BatchQueue
+{
+	std::atomic<size_t> next;
+	size_t end;
+	char pad[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+};
+
+struct BatchSim
+{
+	size_t num_games;
+	Game* games;
+	Input* inputs;
+
+	BatchPolicy policy;
+	void* policy_user;
+
+	size_t num_threads;
+	size_t chunk_size;
+	BatchQueue* queues;
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable start_cv;
+	std::condition_variable done_cv;
+	size_t generation;
+	size_t pending;
+	size_t ticks;
+	bool quit;
+};
+
+// Every game starts from `seed` but draws from its own PCG stream, so
+// games never share random numbers however many there are.
+// num_threads == 0 uses one worker per hardware thread.
+void batch_init(BatchSim* batch, size_t num_games, size_t width, size_t height, uint32_t seed, size_t num_threads = 0);
+
+// Advance every game by `ticks` ticks and return once all are done
+void batch_step(BatchSim* batch, size_t ticks);
+
+void batch_free(BatchSim* batch);
@@ -0,0 +1,290 @@
+// Microbenchmarks for the rasterizer, collision and simulation kernels.
+// Every input comes from fixed xorshift32 seeds so runs are comparable.
+// Prints one CSV row per benchmark with per-operation times from the
+// median, min and max of many timed batches, plus the median absolute
+// deviation as a noise estimate.
+//
+// Usage: bench [--filter substring] [--batches n] [--min-batch-ms ms]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "render.h"
+#include "savestate.h"
+
+#define BENCH_SET_SIZE 1024
+
+struct BenchState
+{
+	Buffer buffer;
+	Renderer* renderer;
+
+	// Random draws and overlap queries, indexed by op % BENCH_SET_SIZE
+	const Sprite* sprites[BENCH_SET_SIZE];
+	size_t xs[BENCH_SET_SIZE], ys[BENCH_SET_SIZE];
+	size_t numbers[BENCH_SET_SIZE];
+
+	Game* busy; // Mid-game state with bullets in flight
+	Game* game; // Scratch copy the benchmarks step
+	Input input;
+	uint32_t input_rng;
+
+	uint64_t sink; // Results go here so the work is not optimized away
+};
+
+typedef void (*BenchFn)(BenchState* state, size_t ops);
+
+static void bench_buffer_clear(BenchState* state, size_t ops)
+{
+	for (size_t i = 0; i < ops; ++i)
+		buffer_clear(&state->buffer, (uint32_t)i);
+	state->sink += state->buffer.data[0];
+}
+
+static void bench_draw_sprite(BenchState* state, size_t ops)
+{
+	for (size_t i = 0; i < ops; ++i)
+	{
+		size_t k = i % BENCH_SET_SIZE;
+		buffer_draw_sprite(&state->buffer, *state->sprites[k], state->xs[k], state->ys[k], (uint32_t)i | 1);
+	}
+	state->sink += state->buffer.data[state->buffer.width * 100 + 100];
+}
+
+static void bench_draw_sprite_bytes(BenchState* state, size_t ops)
+{
+	for (size_t i = 0; i < ops; ++i)
+	{
+		size_t k = i % BENCH_SET_SIZE;
+		buffer_draw_sprite_bytes(&state->buffer, *state->sprites[k], state->xs[k], state->ys[k], (uint32_t)i | 1);
+	}
+	state->sink += state->buffer.data[state->buffer.width * 100 + 100];
+}
+
+static void bench_draw_text(BenchState* state, size_t ops)
+{
+	for (size_t i = 0; i < ops; ++i)
+	{
+		size_t k = i % BENCH_SET_SIZE;
+		buffer_draw_text(&state->buffer, text_spritesheet, "HIGH SCORE", state->xs[k] % 160, state->ys[k] % 240, (uint32_t)i | 1);
+	}
+	state->sink += state->buffer.data[state->buffer.width * 100 + 100];
+}
+
+static void bench_draw_number(BenchState* state, size_t ops)
+{
+	for (size_t i = 0; i < ops; ++i)
+	{
+		size_t k = i % BENCH_SET_SIZE;
+		buffer_draw_number(&state->buffer, number_spritesheet, state->numbers[k], state->xs[k] % 180, state->ys[k] % 240, (uint32_t)i | 1);
+	}
+	state->sink += state->buffer.data[state->buffer.width * 100 + 100];
+}
+
+static void bench_overlap_check(BenchState* state, size_t ops)
+{
+	// Pairs of neighbouring entries, close enough that about half overlap
+	uint64_t hits = 0;
+	for (size_t i = 0; i < ops; ++i)
+	{
+		size_t a = i % BENCH_SET_SIZE;
+		size_t b = (i + 1) % BENCH_SET_SIZE;
+		hits += sprite_overlap_check(
+			*state->sprites[a], state->xs[a] % 16 + 100, state->ys[a] % 16 + 100,
+			*state->sprites[b], state->xs[b] % 16 + 100, state->ys[b] % 16 + 100);
+	}
+	state->sink += hits;
+}
+
+static void bench_game_restore(BenchState* state, size_t ops)
+{
+	for (size_t i = 0; i < ops; ++i)
+	{
+		game_restore(*state->game, state->busy);
+		state->sink += state->game->num_bullets;
+	}
+}
+
+static void bench_bullet_step(BenchState* state, size_t ops)
+{
+	// Includes a restore per op, subtract game_restore for the step alone
+	for (size_t i = 0; i < ops; ++i)
+	{
+		game_restore(*state->game, state->busy);
+		game_step_bullets(*state->game);
+		state->sink += state->game->num_bullets;
+	}
+}
+
+static void headless_input(BenchState* state)
+{
+	// Same scripted player as main_headless
+	Input& input = state->input;
+	uint32_t r = xorshift32(&state->input_rng);
+	if (r % 32 == 0)
+		input.move_dir = int((r >> 8) % 3) - 1;
+	input.fire = r % 8 == 0;
+	input.reset = state->game->player.life == 0;
+	input.game_over = false;
+}
+
+static void bench_tick(BenchState* state, size_t ops)
+{
+	for (size_t i = 0; i < ops; ++i)
+	{
+		headless_input(state);
+		game_step(*state->game, state->input);
+	}
+	state->sink += state->game->score;
+}
+
+static void bench_tick_render(BenchState* state, size_t ops)
+{
+	for (size_t i = 0; i < ops; ++i)
+	{
+		headless_input(state);
+		game_step(*state->game, state->input);
+		game_draw(state->renderer, *state->game);
+		state->sink += renderer_take_rects(state->renderer);
+	}
+}
+
+struct Benchmark
+{
+	const char* name;
+	BenchFn fn;
+	bool from_busy; // Start every run from the busy state
+};
+
+static const Benchmark benchmarks[] = {
+	{ "buffer_clear", bench_buffer_clear, false },
+	{ "buffer_draw_sprite", bench_draw_sprite, false },
+	{ "buffer_draw_sprite_bytes", bench_draw_sprite_bytes, false },
+	{ "buffer_draw_text", bench_draw_text, false },
+	{ "buffer_draw_number", bench_draw_number, false },
+	{ "sprite_overlap_check", bench_overlap_check, false },
+	{ "game_restore", bench_game_restore, true },
+	{ "game_step_bullets", bench_bullet_step, true },
+	{ "game_step", bench_tick, true },
+	{ "game_step_draw", bench_tick_render, true },
+};
+
+static void bench_setup(BenchState* state)
+{
+	state->buffer.width = 224;
+	state->buffer.height = 256;
+	state->buffer.data = new uint32_t[state->buffer.width * state->buffer.height];
+	buffer_clear(&state->buffer, 0);
+	state->renderer = new Renderer;
+	renderer_init(state->renderer, &state->buffer);
+
+	const Sprite* pool[] = {
+		&alien_sprites[0], &alien_sprites[1], &alien_sprites[2], &alien_sprites[3],
+		&alien_sprites[4], &alien_sprites[5], &alien_death_sprite, &player_sprite,
+		&player_bullet_sprite, &alien_bullet_sprite[0], &alien_bullet_sprite[1]
+	};
+	const size_t pool_size = sizeof(pool) / sizeof(pool[0]);
+	uint32_t rng = 13;
+	for (size_t i = 0; i < BENCH_SET_SIZE; ++i)
+	{
+		state->sprites[i] = pool[xorshift32(&rng) % pool_size];
+		state->xs[i] = xorshift32(&rng) % (state->buffer.width - 16);
+		state->ys[i] = xorshift32(&rng) % (state->buffer.height - 16);
+		state->numbers[i] = xorshift32(&rng) % 100000;
+	}
+
+	// Play the scripted player until there are plenty of bullets around
+	state->busy = new Game;
+	state->game = new Game;
+	game_init(*state->game, state->buffer.width, state->buffer.height);
+	state->input = Input();
+	state->input_rng = 7;
+	for (size_t t = 0; t < 100000 && state->game->num_bullets < 8; ++t)
+	{
+		headless_input(state);
+		game_step(*state->game, state->input);
+	}
+	game_save(state->busy, *state->game);
+	state->sink = 0;
+}
+
+static double bench_run(BenchState* state, const Benchmark& bench, size_t ops)
+{
+	if (bench.from_busy)
+	{
+		game_restore(*state->game, state->busy);
+		state->input = Input();
+		state->input_rng = 7;
+		state->renderer->redraw_all = true;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bench.fn(state, ops);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+	std::string filter;
+	size_t num_batches = 21;
+	double min_batch = 0.005;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--filter" && i + 1 < argc)
+			filter = argv[++i];
+		else if (arg == "--batches" && i + 1 < argc)
+			num_batches = std::strtoull(argv[++i], NULL, 10);
+		else if (arg == "--min-batch-ms" && i + 1 < argc)
+			min_batch = std::atof(argv[++i]) / 1000.0;
+	}
+	if (num_batches == 0) num_batches = 1;
+
+	BenchState* state = new BenchState;
+	bench_setup(state);
+
+	printf("benchmark,ops_per_batch,batches,median_ns,min_ns,max_ns,mad_ns\n");
+	for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); ++b)
+	{
+		const Benchmark& bench = benchmarks[b];
+		if (!filter.empty() && std::string(bench.name).find(filter) == std::string::npos)
+			continue;
+
+		// Grow the batch until it runs long enough for the clock, which
+		// doubles as the warm-up
+		size_t ops = 1;
+		while (bench_run(state, bench, ops) < min_batch && ops < ((size_t)1 << 40))
+			ops *= 2;
+
+		std::vector<double> ns(num_batches);
+		for (size_t i = 0; i < num_batches; ++i)
+			ns[i] = bench_run(state, bench, ops) * 1e9 / ops;
+
+		std::sort(ns.begin(), ns.end());
+		double median = ns[num_batches / 2];
+		std::vector<double> deviation(num_batches);
+		for (size_t i = 0; i < num_batches; ++i)
+			deviation[i] = ns[i] > median ? ns[i] - median : median - ns[i];
+		std::sort(deviation.begin(), deviation.end());
+
+		printf("%s,%zu,%zu,%.2f,%.2f,%.2f,%.2f\n", bench.name, ops, num_batches,
+			median, ns[0], ns[num_batches - 1], deviation[num_batches / 2]);
+		fflush(stdout);
+	}
+
+	// Keeps every benchmark's results alive
+	if (state->sink == 42)
+		fprintf(stderr, "\n");
+
+	renderer_free(state->renderer);
+	delete state->renderer;
+	delete[] state->buffer.data;
+	delete state->busy;
+	delete state->game;
+	delete state;
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bundle.h"
+
+static uint32_t get_u32(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t* p)
+{
+	return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+	for (int i = 0; i < 4; ++i)
+		p[i] = uint8_t(v >> (8 * i));
+}
+
+static void put_u64(uint8_t* p, uint64_t v)
+{
+	put_u32(p, uint32_t(v));
+	put_u32(p + 4, uint32_t(v >> 32));
+}
+
+std::string bundle_default_path(const char* argv0)
+{
+	std::string path = argv0 ? argv0 : "";
+	size_t slash = path.rfind('/');
+	return (slash == std::string::npos ? std::string(".") : path.substr(0, slash)) + "/assets.bin";
+}
+
+bool bundle_open(Bundle* bundle, const char* path)
+{
+	bundle->data = NULL;
+	bundle->size = 0;
+	bundle->num_entries = 0;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	void* map = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size >= BUNDLE_HEADER_SIZE)
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		fprintf(stderr, "Error: could not map %s\n", path);
+		return false;
+	}
+	bundle->data = (const uint8_t*)map;
+	bundle->size = st.st_size;
+
+	// Check the whole directory up front so lookups can trust it
+	const uint8_t* p = bundle->data;
+	uint32_t count = get_u32(p + 8);
+	bool ok = memcmp(p, "SIAB", 4) == 0 && get_u32(p + 4) == BUNDLE_VERSION &&
+		count <= (bundle->size - BUNDLE_HEADER_SIZE) / BUNDLE_ENTRY_SIZE;
+	for (uint32_t i = 0; ok && i < count; ++i)
+	{
+		const uint8_t* entry = p + BUNDLE_HEADER_SIZE + i * BUNDLE_ENTRY_SIZE;
+		uint64_t offset = get_u64(entry + 48), size = get_u64(entry + 56);
+		ok = entry[BUNDLE_NAME_SIZE - 1] == 0 && offset % 16 == 0 &&
+			offset <= bundle->size && size <= bundle->size - offset;
+	}
+	if (!ok)
+	{
+		fprintf(stderr, "Error: %s is not a version %d asset bundle\n", path, BUNDLE_VERSION);
+		bundle_close(bundle);
+		return false;
+	}
+	bundle->num_entries = count;
+	return true;
+}
+
+void bundle_close(Bundle* bundle)
+{
+	if (bundle->data)
+		munmap((void*)bundle->data, bundle->size);
+	bundle->data = NULL;
+	bundle->size = 0;
+	bundle->num_entries = 0;
+}
+
+bool bundle_find(const Bundle* bundle, const char* name, uint32_t type, BundleItem* item)
+{
+	for (uint32_t i = 0; i < bundle->num_entries; ++i)
+	{
+		const uint8_t* entry = bundle->data + BUNDLE_HEADER_SIZE + i * BUNDLE_ENTRY_SIZE;
+		if (strcmp((const char*)entry, name) != 0 || get_u32(entry + 32) != type)
+			continue;
+		item->type = type;
+		item->a = get_u32(entry + 36);
+		item->b = get_u32(entry + 40);
+		item->c = get_u32(entry + 44);
+		item->data = bundle->data + get_u64(entry + 48);
+		item->size = get_u64(entry + 56);
+		return true;
+	}
+	return false;
+}
+
+void bundle_add(BundleWriter* writer, const char* name, uint32_t type,
+	uint32_t a, uint32_t b, uint32_t c, const void* data, size_t size)
+{
+	BundleItem item = { type, a, b, c, NULL, size };
+	writer->names.push_back(name);
+	writer->items.push_back(item);
+	writer->payloads.push_back(std::vector<uint8_t>((const uint8_t*)data, (const uint8_t*)data + size));
+}
+
+bool bundle_write(const BundleWriter* writer, const char* path)
+{
+	size_t count = writer->items.size();
+	size_t offset = BUNDLE_HEADER_SIZE + count * BUNDLE_ENTRY_SIZE;
+	std::vector<uint8_t> head(offset, 0);
+	memcpy(&head[0], "SIAB", 4);
+	put_u32(&head[4], BUNDLE_VERSION);
+	put_u32(&head[8], uint32_t(count));
+
+	std::vector<uint64_t> offsets(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		offset = (offset + 15) & ~size_t(15);
+		offsets[i] = offset;
+		offset += writer->payloads[i].size();
+
+		uint8_t* entry = &head[BUNDLE_HEADER_SIZE + i * BUNDLE_ENTRY_SIZE];
+		const BundleItem& item = writer->items[i];
+		strncpy((char*)entry, writer->names[i].c_str(), BUNDLE_NAME_SIZE - 1);
+		put_u32(entry + 32, item.type);
+		put_u32(entry + 36, item.a);
+		put_u32(entry + 40, item.b);
+		put_u32(entry + 44, item.c);
+		put_u64(entry + 48, offsets[i]);
+		put_u64(entry + 56, writer->payloads[i].size());
+	}
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		fprintf(stderr, "Error: could not create %s\n", path);
+		return false;
+	}
+	bool ok = fwrite(head.data(), 1, head.size(), file) == head.size();
+	size_t pos = head.size();
+	static const uint8_t zeros[16] = {};
+	for (size_t i = 0; ok && i < count; ++i)
+	{
+		ok = fwrite(zeros, 1, offsets[i] - pos, file) == offsets[i] - pos;
+		const std::vector<uint8_t>& payload = writer->payloads[i];
+		ok = ok && fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+		pos = offsets[i] + payload.size();
+	}
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+		fprintf(stderr, "Error: could not write %s\n", path);
+	return ok;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One file holding every asset, made by the pack tool and mapped into
+// memory at startup so assets are used where they lie:
+//
+//   0  "SIAB"
+//   4  u32 version
+//   8  u32 entry count
+//  12  u32 reserved
+//  16  entries, 64 bytes each:
+//        0  name, NUL padded to 32 bytes
+//       32  u32 type
+//       36  u32 a, b, c     pcm: sample rate, 0, 0
+//       48  u64 offset      of the payload from the start of the file
+//       56  u64 size        of the payload in bytes
+//
+// All little endian. Payloads start on 16 byte boundaries.
+// Pcm payload: 16-bit mono samples. Sprites and the font are not stored,
+// they are built at compile time (see sprites.h).
+
+#define BUNDLE_VERSION 2 // 2: no sprite entries
+#define BUNDLE_HEADER_SIZE 16
+#define BUNDLE_ENTRY_SIZE 64
+#define BUNDLE_NAME_SIZE 32
+
+enum BundleType
+{
+	BUNDLE_PCM = 2 // 1 was sprites in version 1
+};
+
+struct BundleItem
+{
+	uint32_t type;
+	uint32_t a, b, c;
+	const uint8_t* data;
+	uint64_t size;
+};
+
+struct Bundle
+{
+	const uint8_t* data; // The whole file, mapped read-only
+	size_t size;
+	uint32_t num_entries;
+};
+
+// Next to the executable, so it does not depend on the working directory
+std::string bundle_default_path(const char* argv0);
+
+bool bundle_open(Bundle* bundle, const char* path);
+void bundle_close(Bundle* bundle);
+bool bundle_find(const Bundle* bundle, const char* name, uint32_t type, BundleItem* item);
+
+// Collects items and writes them out as a bundle
+struct BundleWriter
+{
+	std::vector<std::string> names;
+	std::vector<BundleItem> items;
+	std::vector<std::vector<uint8_t> > payloads;
+};
+
+void bundle_add(BundleWriter* writer, const char* name, uint32_t type,
+	uint32_t a, uint32_t b, uint32_t c, const void* data, size_t size);
+bool bundle_write(const BundleWriter* writer, const char* path);
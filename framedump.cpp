@@ -0,0 +1,403 @@
+#include <cstring>
+#include <vector>
+#include "framedump.h"
+
+FrameDumpFormat frame_dump_format(const char* path)
+{
+	size_t n = strlen(path);
+	if (n >= 4 && strcmp(path + n - 4, ".png") == 0) return FRAME_DUMP_PNG;
+	if (n >= 4 && strcmp(path + n - 4, ".y4m") == 0) return FRAME_DUMP_Y4M;
+	return FRAME_DUMP_RAW;
+}
+
+// Scratch space of the writer thread, reused for every frame
+struct FrameEncoder
+{
+	std::vector<uint8_t> pixels; // Top row first, RGBA or RGB
+	std::vector<uint8_t> out;
+	std::vector<int32_t> hash_head;
+};
+
+// Pixels are 0xRRGGBBAA with row 0 at the bottom
+static void frame_to_bytes(const uint32_t* frame, size_t width, size_t height,
+	bool alpha, bool png_filter, std::vector<uint8_t>& bytes)
+{
+	size_t channels = alpha ? 4 : 3;
+	size_t row_size = width * channels + (png_filter ? 1 : 0);
+	bytes.resize(row_size * height);
+	for (size_t y = 0; y < height; ++y)
+	{
+		const uint32_t* src = frame + (height - 1 - y) * width;
+		uint8_t* dst = &bytes[y * row_size];
+		if (png_filter)
+			*dst++ = 0; // No filter
+		for (size_t x = 0; x < width; ++x)
+		{
+			uint32_t p = src[x];
+			*dst++ = uint8_t(p >> 24);
+			*dst++ = uint8_t(p >> 16);
+			*dst++ = uint8_t(p >> 8);
+			if (alpha)
+				*dst++ = uint8_t(p);
+		}
+	}
+}
+
+// Minimal zlib stream: one deflate block with the fixed Huffman codes
+// and greedy LZ77 matches from a single-entry hash table. Frames are
+// mostly long runs of the same few colors, which this handles well.
+
+struct BitWriter
+{
+	std::vector<uint8_t>* out;
+	uint32_t bits;
+	int count;
+};
+
+static void put_bits(BitWriter& w, uint32_t value, int n)
+{
+	w.bits |= value << w.count;
+	w.count += n;
+	while (w.count >= 8)
+	{
+		w.out->push_back(uint8_t(w.bits));
+		w.bits >>= 8;
+		w.count -= 8;
+	}
+}
+
+// Huffman codes go out most significant bit first
+static void put_code(BitWriter& w, uint32_t code, int n)
+{
+	uint32_t reversed = 0;
+	for (int i = 0; i < n; ++i)
+		reversed |= ((code >> i) & 1) << (n - 1 - i);
+	put_bits(w, reversed, n);
+}
+
+static void put_symbol(BitWriter& w, int symbol)
+{
+	if (symbol < 144) put_code(w, 0x30 + symbol, 8);
+	else if (symbol < 256) put_code(w, 0x190 + symbol - 144, 9);
+	else if (symbol < 280) put_code(w, symbol - 256, 7);
+	else put_code(w, 0xc0 + symbol - 280, 8);
+}
+
+static const uint16_t length_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static void put_match(BitWriter& w, size_t length, size_t distance)
+{
+	int l = 28;
+	while (length_base[l] > length) --l;
+	put_symbol(w, 257 + l);
+	put_bits(w, uint32_t(length - length_base[l]), length_extra[l]);
+	int d = 29;
+	while (dist_base[d] > distance) --d;
+	put_code(w, d, 5);
+	put_bits(w, uint32_t(distance - dist_base[d]), dist_extra[d]);
+}
+
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_WINDOW 32768
+#define DEFLATE_MAX_MATCH 258
+
+static void zlib_compress(const std::vector<uint8_t>& in, std::vector<int32_t>& hash_head, std::vector<uint8_t>& out)
+{
+	out.push_back(0x78);
+	out.push_back(0x01);
+	BitWriter w = { &out, 0, 0 };
+	put_bits(w, 1, 1); // Final block
+	put_bits(w, 1, 2); // Fixed Huffman codes
+
+	hash_head.assign(size_t(1) << DEFLATE_HASH_BITS, -1);
+	const uint8_t* data = in.data();
+	size_t n = in.size();
+	for (size_t i = 0; i < n; )
+	{
+		size_t best = 0, distance = 0;
+		if (i + 3 <= n)
+		{
+			uint32_t h = ((data[i] << 16) | (data[i + 1] << 8) | data[i + 2]) * 2654435761u >> (32 - DEFLATE_HASH_BITS);
+			int32_t candidate = hash_head[h];
+			hash_head[h] = int32_t(i);
+			if (candidate >= 0 && i - candidate <= DEFLATE_WINDOW)
+			{
+				size_t limit = n - i < DEFLATE_MAX_MATCH ? n - i : DEFLATE_MAX_MATCH;
+				while (best < limit && data[candidate + best] == data[i + best])
+					++best;
+				distance = i - candidate;
+			}
+		}
+		if (best >= 3)
+		{
+			put_match(w, best, distance);
+			i += best;
+		}
+		else
+		{
+			put_symbol(w, data[i]);
+			++i;
+		}
+	}
+	put_symbol(w, 256);
+	if (w.count > 0)
+		out.push_back(uint8_t(w.bits));
+
+	uint32_t a = 1, b = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		a = (a + data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	uint32_t adler = (b << 16) | a;
+	for (int s = 24; s >= 0; s -= 8)
+		out.push_back(uint8_t(adler >> s));
+}
+
+static uint32_t crc_table[256];
+
+static void crc_init()
+{
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k)
+			c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+		crc_table[i] = c;
+	}
+}
+
+static uint32_t crc32(const uint8_t* data, size_t n, uint32_t crc = 0)
+{
+	crc = ~crc;
+	for (size_t i = 0; i < n; ++i)
+		crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void put_be32(uint8_t* p, uint32_t v)
+{
+	p[0] = uint8_t(v >> 24);
+	p[1] = uint8_t(v >> 16);
+	p[2] = uint8_t(v >> 8);
+	p[3] = uint8_t(v);
+}
+
+static bool png_chunk(FILE* file, const char* type, const uint8_t* data, size_t size)
+{
+	uint8_t head[8], tail[4];
+	put_be32(head, uint32_t(size));
+	memcpy(head + 4, type, 4);
+	put_be32(tail, crc32(data, size, crc32(head + 4, 4)));
+	return fwrite(head, 1, 8, file) == 8 &&
+		fwrite(data, 1, size, file) == size &&
+		fwrite(tail, 1, 4, file) == 4;
+}
+
+static bool write_png(FrameDump* dump, FrameEncoder* enc, const uint32_t* frame, uint64_t number)
+{
+	frame_to_bytes(frame, dump->width, dump->height, false, true, enc->pixels);
+	enc->out.clear();
+	zlib_compress(enc->pixels, enc->hash_head, enc->out);
+
+	char name[32];
+	snprintf(name, sizeof(name), "%06llu.png", (unsigned long long)number);
+	std::string path = dump->path.substr(0, dump->path.size() - 4) + name;
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		fprintf(stderr, "Error: could not create %s\n", path.c_str());
+		return false;
+	}
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	uint8_t ihdr[13];
+	put_be32(ihdr, uint32_t(dump->width));
+	put_be32(ihdr + 4, uint32_t(dump->height));
+	ihdr[8] = 8; // Bits per channel
+	ihdr[9] = 2; // RGB
+	ihdr[10] = ihdr[11] = ihdr[12] = 0;
+	bool ok = fwrite(signature, 1, 8, file) == 8 &&
+		png_chunk(file, "IHDR", ihdr, sizeof(ihdr)) &&
+		png_chunk(file, "IDAT", enc->out.data(), enc->out.size()) &&
+		png_chunk(file, "IEND", NULL, 0);
+	ok = fclose(file) == 0 && ok;
+	return ok;
+}
+
+// Full range BT.601 chroma of a 2x2 block from its channel sums, so the
+// +128 bias is scaled by the 4 pixels and the 8 fraction bits: 128 << 10
+static constexpr uint8_t y4m_chroma(int sum)
+{
+	return uint8_t(sum + (128 << 10) + 512 >= 256 << 10 ? 255 : (sum + (128 << 10) + 512) >> 10);
+}
+static constexpr uint8_t y4m_u(int r, int g, int b) { return y4m_chroma(-43 * r - 85 * g + 128 * b); }
+static constexpr uint8_t y4m_v(int r, int g, int b) { return y4m_chroma(128 * r - 107 * g - 21 * b); }
+
+// Gray carries no chroma, pure blue and red saturate without wrapping
+static_assert(y4m_u(0, 0, 0) == 128 && y4m_v(0, 0, 0) == 128, "black must have neutral chroma");
+static_assert(y4m_u(4 * 128, 4 * 128, 4 * 128) == 128 && y4m_v(4 * 128, 4 * 128, 4 * 128) == 128, "gray must have neutral chroma");
+static_assert(y4m_u(4 * 255, 4 * 255, 4 * 255) == 128 && y4m_v(4 * 255, 4 * 255, 4 * 255) == 128, "white must have neutral chroma");
+static_assert(y4m_u(0, 0, 4 * 255) == 255 && y4m_v(4 * 255, 0, 0) == 255, "chroma must saturate");
+
+// Full range BT.601, chroma averaged over 2x2 blocks
+static bool write_y4m(FrameDump* dump, FrameEncoder* enc, const uint32_t* frame)
+{
+	size_t w = dump->width, h = dump->height;
+	size_t cw = (w + 1) / 2, ch = (h + 1) / 2;
+	frame_to_bytes(frame, w, h, true, false, enc->pixels);
+	enc->out.resize(6 + w * h + 2 * cw * ch);
+	memcpy(enc->out.data(), "FRAME\n", 6);
+	uint8_t* y_plane = &enc->out[6];
+	uint8_t* u_plane = y_plane + w * h;
+	uint8_t* v_plane = u_plane + cw * ch;
+	const uint8_t* rgba = enc->pixels.data();
+
+	for (size_t i = 0; i < w * h; ++i)
+	{
+		const uint8_t* p = rgba + i * 4;
+		y_plane[i] = uint8_t((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+	}
+	for (size_t cy = 0; cy < ch; ++cy)
+	{
+		for (size_t cx = 0; cx < cw; ++cx)
+		{
+			int r = 0, g = 0, b = 0;
+			for (size_t k = 0; k < 4; ++k)
+			{
+				size_t x = cx * 2 + (k & 1), y = cy * 2 + (k >> 1);
+				if (x >= w) x = w - 1;
+				if (y >= h) y = h - 1;
+				const uint8_t* p = rgba + (y * w + x) * 4;
+				r += p[0]; g += p[1]; b += p[2];
+			}
+			u_plane[cy * cw + cx] = y4m_u(r, g, b);
+			v_plane[cy * cw + cx] = y4m_v(r, g, b);
+		}
+	}
+	return fwrite(enc->out.data(), 1, enc->out.size(), dump->file) == enc->out.size();
+}
+
+static bool write_raw(FrameDump* dump, FrameEncoder* enc, const uint32_t* frame)
+{
+	frame_to_bytes(frame, dump->width, dump->height, true, false, enc->pixels);
+	return fwrite(enc->pixels.data(), 1, enc->pixels.size(), dump->file) == enc->pixels.size();
+}
+
+static void frame_dump_thread(FrameDump* dump)
+{
+	FrameEncoder enc;
+	std::unique_lock<std::mutex> lock(dump->mutex);
+	for (;;)
+	{
+		while (dump->count == 0 && !dump->quit)
+			dump->ready_cv.wait(lock);
+		if (dump->count == 0)
+			break;
+		const uint32_t* frame = dump->slots[dump->head];
+		uint64_t number = dump->frames_written;
+		lock.unlock();
+
+		if (!dump->failed)
+		{
+			bool ok = false;
+			switch (dump->format)
+			{
+			case FRAME_DUMP_RAW: ok = write_raw(dump, &enc, frame); break;
+			case FRAME_DUMP_PNG: ok = write_png(dump, &enc, frame, number); break;
+			case FRAME_DUMP_Y4M: ok = write_y4m(dump, &enc, frame); break;
+			}
+			dump->failed = !ok;
+		}
+
+		lock.lock();
+		dump->head = (dump->head + 1) % FRAME_DUMP_SLOTS;
+		dump->count--;
+		dump->frames_written++;
+		dump->free_cv.notify_one();
+	}
+}
+
+bool frame_dump_open(FrameDump* dump, const char* path, FrameDumpFormat format, size_t width, size_t height)
+{
+	crc_init();
+	dump->format = format;
+	dump->path = path;
+	dump->width = width;
+	dump->height = height;
+	dump->file = NULL;
+	dump->failed = false;
+	if (format != FRAME_DUMP_PNG)
+	{
+		dump->file = fopen(path, "wb");
+		if (!dump->file)
+		{
+			fprintf(stderr, "Error: could not create %s\n", path);
+			return false;
+		}
+	}
+	if (format == FRAME_DUMP_Y4M)
+		fprintf(dump->file, "YUV4MPEG2 W%zu H%zu F60:1 Ip A1:1 C420jpeg\n", width, height);
+
+	for (size_t i = 0; i < FRAME_DUMP_SLOTS; ++i)
+		dump->slots[i] = new uint32_t[width * height];
+	dump->head = 0;
+	dump->count = 0;
+	dump->frames_queued = 0;
+	dump->frames_written = 0;
+	dump->quit = false;
+	dump->writer = std::thread(frame_dump_thread, dump);
+	return true;
+}
+
+void frame_dump_write(FrameDump* dump, const Buffer& buffer)
+{
+	std::unique_lock<std::mutex> lock(dump->mutex);
+	while (dump->count == FRAME_DUMP_SLOTS)
+		dump->free_cv.wait(lock);
+	// Only this thread adds to the queue, so the slot stays free unlocked
+	uint32_t* slot = dump->slots[(dump->head + dump->count) % FRAME_DUMP_SLOTS];
+	lock.unlock();
+
+	memcpy(slot, buffer.data, dump->width * dump->height * sizeof(uint32_t));
+
+	lock.lock();
+	dump->count++;
+	dump->frames_queued++;
+	dump->ready_cv.notify_one();
+}
+
+bool frame_dump_close(FrameDump* dump)
+{
+	{
+		std::lock_guard<std::mutex> lock(dump->mutex);
+		dump->quit = true;
+		dump->ready_cv.notify_one();
+	}
+	dump->writer.join();
+
+	bool ok = !dump->failed;
+	if (dump->file)
+		ok = fclose(dump->file) == 0 && ok;
+	dump->file = NULL;
+	for (size_t i = 0; i < FRAME_DUMP_SLOTS; ++i)
+		delete[] dump->slots[i];
+	if (!ok)
+		fprintf(stderr, "Error: could not write frames to %s\n", dump->path.c_str());
+	return ok;
+}
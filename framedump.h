@@ -0,0 +1,59 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "render.h"
+
+// Streams rendered frames to disk from a background thread:
+//
+//   raw  RGBA bytes, top row first, frames back to back
+//   png  one file per frame, `path` minus ".png" plus a 6 digit number
+//   y4m  YUV4MPEG2 4:2:0 at 60 fps, for ffmpeg and most players
+//
+// Frames are copied into one of FRAME_DUMP_SLOTS recycled buffers and
+// queued. When all of them are waiting to be written, frame_dump_write
+// blocks until one is free, so a fast producer is slowed down instead of
+// losing frames or growing memory.
+
+enum FrameDumpFormat
+{
+	FRAME_DUMP_RAW,
+	FRAME_DUMP_PNG,
+	FRAME_DUMP_Y4M
+};
+
+#define FRAME_DUMP_SLOTS 8
+
+struct FrameDump
+{
+	FrameDumpFormat format;
+	std::string path;
+	size_t width, height;
+	FILE* file; // raw and y4m
+	bool failed; // A write failed, later frames are dropped
+
+	uint32_t* slots[FRAME_DUMP_SLOTS];
+	// Ring of queued slots, [head, head + count) mod FRAME_DUMP_SLOTS.
+	// Slots outside it are free to fill.
+	size_t head, count;
+	uint64_t frames_queued, frames_written;
+	bool quit;
+	std::mutex mutex;
+	std::condition_variable ready_cv; // Writer waits for a frame
+	std::condition_variable free_cv; // Producer waits for a free slot
+	std::thread writer;
+};
+
+// Picks the format from the extension: .png, .y4m, anything else is raw
+FrameDumpFormat frame_dump_format(const char* path);
+
+bool frame_dump_open(FrameDump* dump, const char* path, FrameDumpFormat format, size_t width, size_t height);
+// Queues a copy of buffer, which must be width x height
+void frame_dump_write(FrameDump* dump, const Buffer& buffer);
+// Writes out everything queued and closes the output. Returns false if
+// any frame could not be written.
+bool frame_dump_close(FrameDump* dump);
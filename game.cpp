@@ -0,0 +1,575 @@
+#include "game.h"
+#include "sprites.h"
+#include "profile.h"
+
+#if defined(_MSC_VER)
+#define ASSERT(x) if (!(x)) __debugbreak();
+#else
+#define ASSERT(x) if (!(x)) __builtin_trap();
+#endif
+
+#define ALIEN_BULLET_FRAME_DURATION 5
+
+// Spacing of the alien formation and where it starts
+#define ALIEN_PITCH_X 16
+#define ALIEN_PITCH_Y 17
+#define ALIEN_START_X 24
+#define ALIEN_START_Y 128
+
+static_assert(GAME_ALIEN_ROWS <= 64, "SwarmGrid keeps one 64-bit mask per column");
+static_assert(GAME_MAX_ALIENS <= 65536, "Game::alive holds 16-bit indices");
+
+static int floor_div(int a, int b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static void game_place_aliens(Game& game)
+{
+	SwarmGrid& grid = game.swarm_grid;
+	grid.origin_x = game.alien_swarm_position;
+	grid.origin_y = ALIEN_START_Y;
+
+	grid.left_column = 0;
+	grid.right_column = GAME_ALIEN_COLUMNS - 1;
+	for (size_t xi = 0; xi < GAME_ALIEN_COLUMNS; ++xi)
+	{
+		grid.column_alive[xi] = ~0ull >> (64 - GAME_ALIEN_ROWS);
+
+		for (size_t yi = 0; yi < GAME_ALIEN_ROWS; ++yi)
+		{
+			size_t ai = xi * GAME_ALIEN_ROWS + yi;
+
+			game.death_counters[ai] = 10;
+			game.alive[ai] = uint16_t(ai);
+			game.alive_slot[ai] = uint16_t(ai);
+
+			// Top row is type A, the next two B and the rest C
+			size_t row_from_top = GAME_ALIEN_ROWS - 1 - yi;
+			if (row_from_top == 0)
+				game.alien_type[ai] = ALIEN_TYPE_A;
+			else if (row_from_top <= 2)
+				game.alien_type[ai] = ALIEN_TYPE_B;
+			else
+				game.alien_type[ai] = ALIEN_TYPE_C;
+
+			const Sprite& sprite = alien_sprites[2 * (game.alien_type[ai] - 1)];
+
+			game.alien_x[ai] = grid.origin_x + ALIEN_PITCH_X * xi + (alien_death_sprite.width - sprite.width) / 2;
+			game.alien_y[ai] = grid.origin_y + ALIEN_PITCH_Y * yi;
+			game.alien_width[ai] = sprite.width;
+		}
+	}
+}
+
+// Clears alien ai's bit and moves the outer columns in past any that
+// emptied. Columns never refill within a level, so each bound moves at
+// most GAME_ALIEN_COLUMNS times per level.
+static void swarm_grid_remove(SwarmGrid& grid, size_t ai)
+{
+	size_t xi = ai / GAME_ALIEN_ROWS;
+	grid.column_alive[xi] &= ~(1ull << (ai % GAME_ALIEN_ROWS));
+	if (grid.column_alive[xi])
+		return;
+	while (grid.left_column < grid.right_column && !grid.column_alive[grid.left_column])
+		++grid.left_column;
+	while (grid.right_column > grid.left_column && !grid.column_alive[grid.right_column])
+		--grid.right_column;
+}
+
+// Swap-remove from the alive list: the last live alien takes ai's slot.
+// Must run before aliens_killed is incremented.
+static void game_remove_alive(Game& game, size_t ai)
+{
+	size_t slot = game.alive_slot[ai];
+	uint16_t last = game.alive[game.num_aliens - game.aliens_killed - 1];
+	game.alive[slot] = last;
+	game.alive_slot[last] = uint16_t(slot);
+}
+
+// First live alien, in index order, with a pixel under the given sprite.
+// Only the formation cells under the sprite's rectangle are looked at.
+static size_t game_first_alien_hit(const Game& game, const Sprite& sprite, int rx, int ry)
+{
+	const SwarmGrid& grid = game.swarm_grid;
+	const int cell_width = alien_death_sprite.width;
+	const int cell_height = alien_sprites[0].height;
+	const int rw = sprite.width;
+	const int rh = sprite.height;
+	const size_t frame = game_alien_frame(game);
+
+	int lx = rx - grid.origin_x;
+	int ly = ry - grid.origin_y;
+	int xi_lo = floor_div(lx - cell_width, ALIEN_PITCH_X) + 1;
+	int xi_hi = floor_div(lx + rw - 1, ALIEN_PITCH_X);
+	int yi_lo = floor_div(ly - cell_height, ALIEN_PITCH_Y) + 1;
+	int yi_hi = floor_div(ly + rh - 1, ALIEN_PITCH_Y);
+	if (xi_lo < 0) xi_lo = 0;
+	if (yi_lo < 0) yi_lo = 0;
+	if (xi_hi > GAME_ALIEN_COLUMNS - 1) xi_hi = GAME_ALIEN_COLUMNS - 1;
+	if (yi_hi > GAME_ALIEN_ROWS - 1) yi_hi = GAME_ALIEN_ROWS - 1;
+	if (xi_lo > xi_hi || yi_lo > yi_hi) return game.num_aliens;
+
+	uint64_t row_mask = (~0ull >> (63 - yi_hi)) & (~0ull << yi_lo);
+	for (int xi = xi_lo; xi <= xi_hi; ++xi)
+	{
+		uint64_t alive = grid.column_alive[xi] & row_mask;
+		while (alive)
+		{
+			size_t ai = xi * GAME_ALIEN_ROWS + __builtin_ctzll(alive);
+			alive &= alive - 1;
+
+			const Sprite& alien_sprite = alien_sprites[2 * (game.alien_type[ai] - 1) + frame];
+			if (sprite_overlap_check(sprite, rx, ry, alien_sprite, game.alien_x[ai], game.alien_y[ai]))
+				return ai;
+		}
+	}
+	return game.num_aliens;
+}
+
+static size_t game_bullet_band(const Game& game, int x)
+{
+	if (x < 0) return 0;
+	size_t band = x / game.bullet_grid.band_width;
+	return band < GAME_BULLET_BANDS ? band : GAME_BULLET_BANDS - 1;
+}
+
+static void game_bullet_grid_set(Game& game, size_t bi, bool set)
+{
+	uint64_t& word = game.bullet_grid.bands[game_bullet_band(game, game.bullet_x[bi])][bi / 64];
+	if (set)
+		word |= 1ull << (bi % 64);
+	else
+		word &= ~(1ull << (bi % 64));
+}
+
+static void game_clear_bullets(Game& game)
+{
+	game.num_bullets = 0;
+	game.bullet_grid.band_width = (game.width + GAME_BULLET_BANDS - 1) / GAME_BULLET_BANDS;
+	for (size_t band = 0; band < GAME_BULLET_BANDS; ++band)
+		for (size_t w = 0; w < GAME_BULLET_WORDS; ++w)
+			game.bullet_grid.bands[band][w] = 0;
+}
+
+static void game_add_bullet(Game& game, int x, int y, int dir)
+{
+	size_t bi = game.num_bullets;
+	game.bullet_x[bi] = x;
+	game.bullet_y[bi] = y;
+	game.bullet_dir[bi] = dir;
+	game_bullet_grid_set(game, bi, true);
+	++game.num_bullets;
+}
+
+// Swap-remove: the last bullet takes the slot of bullet bi
+static void game_remove_bullet(Game& game, size_t bi)
+{
+	size_t last = game.num_bullets - 1;
+	game_bullet_grid_set(game, bi, false);
+	if (bi != last)
+	{
+		game_bullet_grid_set(game, last, false);
+		game.bullet_x[bi] = game.bullet_x[last];
+		game.bullet_y[bi] = game.bullet_y[last];
+		game.bullet_dir[bi] = game.bullet_dir[last];
+		game_bullet_grid_set(game, bi, true);
+	}
+	--game.num_bullets;
+}
+
+// First bullet other than bi, in index order, that overlaps player bullet bi
+static size_t game_first_bullet_hit(const Game& game, size_t bi)
+{
+	const Sprite& alien_bullet = alien_bullet_sprite[game_alien_bullet_frame(game)];
+	const BulletGrid& grid = game.bullet_grid;
+	int x = game.bullet_x[bi];
+	size_t band_lo = game_bullet_band(game, x - (int)alien_bullet_sprite[0].width + 1);
+	size_t band_hi = game_bullet_band(game, x + (int)player_bullet_sprite.width - 1);
+
+	for (size_t w = 0; w < GAME_BULLET_WORDS; ++w)
+	{
+		uint64_t candidates = 0;
+		for (size_t band = band_lo; band <= band_hi; ++band)
+			candidates |= grid.bands[band][w];
+
+		while (candidates)
+		{
+			size_t bj = w * 64 + __builtin_ctzll(candidates);
+			candidates &= candidates - 1;
+			if (bj == bi) continue;
+
+			const Sprite& other = game.bullet_dir[bj] > 0 ? player_bullet_sprite : alien_bullet;
+			bool overlap = sprite_overlap_check(
+				player_bullet_sprite, game.bullet_x[bi], game.bullet_y[bi],
+				other, game.bullet_x[bj], game.bullet_y[bj]
+			);
+			if (overlap) return bj;
+		}
+	}
+	return game.num_bullets;
+}
+
+// Called when the swarm is cleared or the player asked for a reset
+static void game_next_level(Game& game, bool reset)
+{
+	if (reset)
+	{
+		game.player.life = 3;
+		game.score = 0;
+		game.level = 0;
+	}
+	game.should_change_speed = true;
+	game.level++;
+	game_clear_bullets(game);
+	game.alien_swarm_max_position = game.width - ALIEN_PITCH_X * GAME_ALIEN_COLUMNS - 3; //Reset max alien width
+	if (game.level <= 8)
+		game.alien_update_frequency = 120 - (game.level * 10);
+	else if (game.level <= 36) // 120-80-36 = 4 since each level doubles in speed twice, this is maximum speed.
+		game.alien_update_frequency = 120 - 8 * 10 - game.level;
+	else
+		game.alien_update_frequency = 4;
+
+	game.alien_swarm_position = ALIEN_START_X;
+
+	game.aliens_killed = 0;
+	game.alien_update_timer = 0;
+	game.alien_animation_time = 0;
+
+	game.alien_move_dir = 4;
+
+	game_place_aliens(game);
+}
+
+void game_init(Game& game, size_t width, size_t height, uint32_t seed, uint32_t high_score)
+{
+	game.width = width;
+	game.height = height;
+	game_clear_bullets(game);
+	game.num_aliens = GAME_MAX_ALIENS;
+
+	game.player.x = 112 - 5;
+	game.player.y = 32;
+	game.player.life = 3;
+
+	game.alien_swarm_position = ALIEN_START_X;
+	game.alien_swarm_max_position = game.width - ALIEN_PITCH_X * GAME_ALIEN_COLUMNS - 3;
+	game.alien_update_frequency = 120;
+	game.alien_update_timer = 0;
+	game.aliens_killed = 0;
+	game.should_change_speed = false;
+	game.alien_move_dir = 4;
+
+	game.alien_animation_time = 0;
+	game.alien_bullet_animation_time = 0;
+
+	game.score = 0;
+	game.level = 1;
+	game.high_score = high_score;
+	rng_seed(&game.rng, seed);
+	game.events = 0;
+
+	// Padding lanes stay zero-width so the SIMD hit test skips them
+	for (size_t ai = 0; ai < GAME_ALIEN_CAPACITY; ++ai)
+	{
+		game.alien_x[ai] = 0;
+		game.alien_y[ai] = 0;
+		game.alien_width[ai] = 0;
+		game.alien_type[ai] = ALIEN_DEAD;
+		game.death_counters[ai] = 0;
+		game.alive[ai] = 0;
+		game.alive_slot[ai] = 0;
+	}
+
+	game_place_aliens(game);
+}
+
+size_t game_alien_frame(const Game& game)
+{
+	return game.alien_animation_time / game.alien_update_frequency;
+}
+
+size_t game_alien_bullet_frame(const Game& game)
+{
+	return game.alien_bullet_animation_time / ALIEN_BULLET_FRAME_DURATION;
+}
+
+void game_step_bullets(Game& game)
+{
+	profile_begin(PROFILE_SIM_BULLETS);
+	for (size_t bi = 0; bi < game.num_bullets; ++bi)
+	{
+		game.bullet_y[bi] += game.bullet_dir[bi];
+		if (game.bullet_y[bi] >= (int)game.height || game.bullet_y[bi] < (int)player_bullet_sprite.height)
+		{
+			game_remove_bullet(game, bi);
+			continue;
+		}
+
+		// Alien bullet
+		if (game.bullet_dir[bi] < 0)
+		{
+			profile_begin(PROFILE_SIM_COLLISION);
+			bool overlap = sprite_overlap_check(
+				alien_bullet_sprite[game_alien_bullet_frame(game)], game.bullet_x[bi], game.bullet_y[bi],
+				player_sprite, game.player.x, game.player.y
+			);
+			profile_end(PROFILE_SIM_COLLISION);
+
+			if (overlap)
+			{
+				game.events |= GAME_EVENT_PLAYER_HIT;
+				--game.player.life;
+				if (game.player.life == 0)
+					game.events |= GAME_EVENT_GAME_OVER;
+				game_remove_bullet(game, bi);
+				//NOTE: The rest of the frame is still going to be simulated.
+				//perhaps we need to check if the game is over or not.
+				break;
+			}
+		}
+		// Player bullet
+		else
+		{
+			// Check if player bullet hits an alien bullet
+			profile_begin(PROFILE_SIM_COLLISION);
+			size_t bj = game_first_bullet_hit(game, bi);
+			size_t ai = bj < game.num_bullets ? game.num_aliens :
+				game_first_alien_hit(game, player_bullet_sprite, game.bullet_x[bi], game.bullet_y[bi]);
+			profile_end(PROFILE_SIM_COLLISION);
+			if (bj < game.num_bullets)
+			{
+				// If hi is the last slot it has to go first, otherwise it
+				// would be moved into lo's place
+				size_t lo = (bi < bj) ? bi : bj;
+				size_t hi = (bi < bj) ? bj : bi;
+				if (hi == game.num_bullets - 1)
+				{
+					game_remove_bullet(game, hi);
+					game_remove_bullet(game, lo);
+				}
+				else
+				{
+					game_remove_bullet(game, lo);
+					game_remove_bullet(game, hi);
+				}
+				// Both bullets are gone, slot bi may now be past the end
+				continue;
+			}
+
+			// Check hit
+			if (ai < game.num_aliens)
+			{
+				//if top row
+				if (game.alien_type[ai] == 1)
+					game.score += 40;
+				else
+					game.score += 10 * (4 - game.alien_type[ai]);
+				game.alien_type[ai] = ALIEN_DEAD;
+				game_remove_alive(game, ai);
+				swarm_grid_remove(game.swarm_grid, ai);
+				// NOTE: Hack to recenter death sprite
+				game.alien_x[ai] -= (alien_death_sprite.width - game.alien_width[ai]) / 2;
+				game.alien_width[ai] = 0;
+				game_remove_bullet(game, bi);
+				++game.aliens_killed;
+				game.events |= GAME_EVENT_ALIEN_KILLED;
+
+				if (game.aliens_killed % 15 == 0) game.should_change_speed = true;
+			}
+		}
+	}
+	profile_end(PROFILE_SIM_BULLETS);
+}
+
+void game_step(Game& game, const Input& input)
+{
+	PROFILE_SCOPE(PROFILE_SIM_TICK);
+	game.events = 0;
+
+	if (input.game_over && game.player.life > 0)
+	{
+		game.player.life = 0;
+		game.events |= GAME_EVENT_GAME_OVER;
+	}
+
+	if (game.player.life == 0)
+	{
+		if (input.reset)
+			game_next_level(game, true);
+		return;
+	}
+
+	// Simulate bullets
+	game_step_bullets(game);
+
+	// Simulate aliens
+	profile_begin(PROFILE_SIM_SWARM);
+	if (game.should_change_speed)
+	{
+		game.should_change_speed = false;
+		game.alien_update_frequency /= 2;
+	}
+
+	// Update death counters
+	for (size_t ai = 0; ai < game.num_aliens; ++ai)
+	{
+		if (game.alien_type[ai] == ALIEN_DEAD && game.death_counters[ai])
+		{
+			--game.death_counters[ai];
+		}
+	}
+
+	if (game.alien_update_timer >= game.alien_update_frequency)
+	{
+		game.events |= GAME_EVENT_ALIEN_MOVE;
+		game.alien_update_timer = 0;
+
+		if ((int)game.alien_swarm_position + game.alien_move_dir < 0)
+		{
+			game.alien_move_dir *= -1;
+			//TODO: Perhaps if aliens get close enough to player, we need to check
+			//for overlap. What happens when alien moves over line y = 0 line?
+			simd_add_i16(game.alien_y, game.num_aliens, -8);
+			game.swarm_grid.origin_y -= 8;
+		}
+		else if (game.alien_swarm_position > game.alien_swarm_max_position - game.alien_move_dir)
+		{
+			game.alien_move_dir *= -1;
+		}
+		game.alien_swarm_position += game.alien_move_dir;
+
+		simd_add_i16(game.alien_x, game.num_aliens, game.alien_move_dir);
+		game.swarm_grid.origin_x += game.alien_move_dir;
+
+		if (game.aliens_killed < game.num_aliens)
+		{
+			uint32_t num_alive = uint32_t(game.num_aliens - game.aliens_killed);
+			size_t rai = game.alive[rng_range(&game.rng, num_alive)];
+			if (game.num_bullets < GAME_MAX_BULLETS) {
+				game_add_bullet(game,
+					game.alien_x[rai] + game.alien_width[rai] / 2,
+					game.alien_y[rai] - alien_bullet_sprite[0].height,
+					-2);
+			}
+		}
+	}
+
+	profile_end(PROFILE_SIM_SWARM);
+
+	// Update animations
+	++game.alien_animation_time;
+	if (game.alien_animation_time >= 2 * game.alien_update_frequency)
+	{
+		game.alien_animation_time = 0;
+	}
+	++game.alien_bullet_animation_time;
+	if (game.alien_bullet_animation_time >= 2 * ALIEN_BULLET_FRAME_DURATION)
+	{
+		game.alien_bullet_animation_time = 0;
+	}
+
+	++game.alien_update_timer;
+
+	// Simulate player
+	int player_move_dir = 2 * input.move_dir;
+
+	if (player_move_dir != 0)
+	{
+		if (game.player.x + player_sprite.width + player_move_dir >= game.width)
+		{
+			game.player.x = game.width - player_sprite.width;
+		}
+		else if ((int)game.player.x + player_move_dir <= 0)
+		{
+			game.player.x = 0;
+		}
+		else game.player.x += player_move_dir;
+	}
+
+	if (game.aliens_killed < game.num_aliens && !input.reset)
+	{
+		if (game.score > game.high_score)
+			game.high_score = game.score;
+		// Left edge of the leftmost live column, and the topmost live alien
+		// of the rightmost one, which is the last live alien in index order
+		const SwarmGrid& grid = game.swarm_grid;
+		size_t pos = grid.origin_x + ALIEN_PITCH_X * grid.left_column;
+		if (pos > game.alien_swarm_position) game.alien_swarm_position = pos;
+
+		size_t ai = grid.right_column * GAME_ALIEN_ROWS + 63 - __builtin_clzll(grid.column_alive[grid.right_column]);
+		pos = game.width - game.alien_x[ai] - 13 + pos;
+		if (pos > game.alien_swarm_max_position) game.alien_swarm_max_position = pos;
+		ASSERT(game.alien_swarm_max_position <= game.width);
+	}
+	else
+	{
+		game_next_level(game, input.reset);
+	}
+
+	// Process events
+	if (input.fire && !input.reset && game.num_bullets < GAME_MAX_BULLETS)
+	{
+		game_add_bullet(game,
+			game.player.x + player_sprite.width / 2,
+			game.player.y + player_sprite.height,
+			2);
+		game.events |= GAME_EVENT_PLAYER_SHOOT;
+	}
+}
+
+static uint64_t hash_bytes(uint64_t h, const void* data, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		h ^= bytes[i];
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+static uint64_t hash_value(uint64_t h, uint64_t value)
+{
+	return hash_bytes(h, &value, sizeof(value));
+}
+
+uint64_t game_hash(const Game& game)
+{
+	// Field by field so struct padding never gets in
+	uint64_t h = 0xcbf29ce484222325ull;
+	h = hash_value(h, game.width);
+	h = hash_value(h, game.height);
+	h = hash_value(h, game.num_aliens);
+	h = hash_bytes(h, game.alien_x, game.num_aliens * sizeof(game.alien_x[0]));
+	h = hash_bytes(h, game.alien_y, game.num_aliens * sizeof(game.alien_y[0]));
+	h = hash_bytes(h, game.alien_width, game.num_aliens * sizeof(game.alien_width[0]));
+	h = hash_bytes(h, game.alien_type, game.num_aliens * sizeof(game.alien_type[0]));
+	h = hash_bytes(h, game.death_counters, game.num_aliens * sizeof(game.death_counters[0]));
+	h = hash_bytes(h, game.alive, (game.num_aliens - game.aliens_killed) * sizeof(game.alive[0]));
+	h = hash_value(h, game.player.x);
+	h = hash_value(h, game.player.y);
+	h = hash_value(h, game.player.life);
+	h = hash_value(h, game.num_bullets);
+	h = hash_bytes(h, game.bullet_x, game.num_bullets * sizeof(game.bullet_x[0]));
+	h = hash_bytes(h, game.bullet_y, game.num_bullets * sizeof(game.bullet_y[0]));
+	h = hash_bytes(h, game.bullet_dir, game.num_bullets * sizeof(game.bullet_dir[0]));
+	h = hash_value(h, (uint32_t)game.swarm_grid.origin_x);
+	h = hash_value(h, (uint32_t)game.swarm_grid.origin_y);
+	h = hash_bytes(h, game.swarm_grid.column_alive, sizeof(game.swarm_grid.column_alive));
+	h = hash_value(h, game.alien_swarm_position);
+	h = hash_value(h, game.alien_swarm_max_position);
+	h = hash_value(h, game.alien_update_frequency);
+	h = hash_value(h, game.alien_update_timer);
+	h = hash_value(h, game.aliens_killed);
+	h = hash_value(h, game.should_change_speed);
+	h = hash_value(h, (uint32_t)game.alien_move_dir);
+	h = hash_value(h, game.alien_animation_time);
+	h = hash_value(h, game.alien_bullet_animation_time);
+	h = hash_value(h, game.score);
+	h = hash_value(h, game.level);
+	h = hash_value(h, game.high_score);
+	h = hash_value(h, game.rng.state);
+	h = hash_value(h, game.rng.inc);
+	return h;
+}
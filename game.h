@@ -0,0 +1,142 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "rng.h"
+#include "simd.h"
+
+// Can be raised at build time for stress runs. The formation must still
+// fit inside the game width and have at most 64 rows.
+#ifndef GAME_MAX_BULLETS
+#define GAME_MAX_BULLETS 128
+#endif
+#ifndef GAME_ALIEN_COLUMNS
+#define GAME_ALIEN_COLUMNS 11
+#endif
+#ifndef GAME_ALIEN_ROWS
+#define GAME_ALIEN_ROWS 5
+#endif
+#define GAME_MAX_ALIENS (GAME_ALIEN_COLUMNS * GAME_ALIEN_ROWS)
+
+// Alien arrays are padded to whole SIMD vectors, see simd.h
+#define GAME_ALIEN_CAPACITY SIMD_ROUND_UP(GAME_MAX_ALIENS)
+
+#define GAME_BULLET_BANDS 64
+#define GAME_BULLET_WORDS ((GAME_MAX_BULLETS + 63) / 64)
+
+struct Player
+{
+	size_t x, y;
+	size_t life;
+};
+
+enum AlienType : uint8_t
+{
+	ALIEN_DEAD = 0,
+	ALIEN_TYPE_A = 1,
+	ALIEN_TYPE_B = 2,
+	ALIEN_TYPE_C = 3
+};
+
+// Set in Game::events by game_step so the caller can play sounds
+enum GameEvent : uint32_t
+{
+	GAME_EVENT_PLAYER_SHOOT = 1 << 0,
+	GAME_EVENT_PLAYER_HIT = 1 << 1,
+	GAME_EVENT_ALIEN_KILLED = 1 << 2,
+	GAME_EVENT_ALIEN_MOVE = 1 << 3,
+	GAME_EVENT_GAME_OVER = 1 << 4 // The last life was lost this tick
+};
+
+// Every alien sits in a fixed cell of the formation and the swarm only
+// ever moves as a whole, so hit tests index aliens relative to the
+// formation origin. Moving the swarm just moves the origin and a kill
+// clears one bit; bit yi of column_alive[xi] is alien xi * ROWS + yi.
+// The outermost columns with a live alien follow the kills, so finding
+// the edges of the swarm never scans the aliens.
+struct SwarmGrid
+{
+	int origin_x, origin_y;
+	uint64_t column_alive[GAME_ALIEN_COLUMNS];
+	size_t left_column, right_column;
+};
+
+// Bullets only move vertically, so they are bucketed once by x into
+// vertical bands, with one bit per bullet slot.
+struct BulletGrid
+{
+	size_t band_width;
+	uint64_t bands[GAME_BULLET_BANDS][GAME_BULLET_WORDS];
+};
+
+// Everything that drives one tick, sampled by the caller
+struct Input
+{
+	int move_dir;
+	bool fire;
+	bool reset;
+	bool game_over;
+};
+
+// Complete simulation state. Holds no pointers, so any number of
+// instances can be stepped side by side. Aliens and bullets are stored
+// as structure-of-arrays with 16-bit coordinates.
+struct Game
+{
+	size_t width, height;
+	size_t num_aliens;
+	size_t num_bullets;
+
+	int16_t alien_x[GAME_ALIEN_CAPACITY];
+	int16_t alien_y[GAME_ALIEN_CAPACITY];
+	int16_t alien_width[GAME_ALIEN_CAPACITY]; // 0 once dead
+	uint8_t alien_type[GAME_ALIEN_CAPACITY];
+	uint8_t death_counters[GAME_ALIEN_CAPACITY];
+	// The first num_aliens - aliens_killed entries of alive are the live
+	// aliens in no particular order, alive_slot is where each one is
+	uint16_t alive[GAME_ALIEN_CAPACITY];
+	uint16_t alive_slot[GAME_ALIEN_CAPACITY];
+
+	Player player;
+
+	int16_t bullet_x[GAME_MAX_BULLETS];
+	int16_t bullet_y[GAME_MAX_BULLETS];
+	int8_t bullet_dir[GAME_MAX_BULLETS];
+
+	SwarmGrid swarm_grid;
+	BulletGrid bullet_grid;
+
+	size_t alien_swarm_position;
+	size_t alien_swarm_max_position;
+	size_t alien_update_frequency;
+	size_t alien_update_timer;
+	size_t aliens_killed;
+	bool should_change_speed;
+	int alien_move_dir;
+
+	// All alien types animate in lockstep, one frame per swarm update
+	size_t alien_animation_time;
+	size_t alien_bullet_animation_time;
+
+	size_t score;
+	size_t level;
+	uint32_t high_score;
+	Rng rng;
+	uint32_t events;
+};
+
+// Seeds stream 0 of game.rng, see rng.h for giving instances their own
+void game_init(Game& game, size_t width, size_t height, uint32_t seed = 13, uint32_t high_score = 0);
+
+// Advance the simulation by one tick. Does not allocate.
+void game_step(Game& game, const Input& input);
+
+// The bullet part of game_step: move every bullet and resolve its hits.
+// Exposed so it can be benchmarked on its own.
+void game_step_bullets(Game& game);
+
+size_t game_alien_frame(const Game& game);
+size_t game_alien_bullet_frame(const Game& game);
+
+// 64-bit FNV-1a over every field that affects later ticks. Two games that
+// hash the same will keep doing the same thing given the same input.
+uint64_t game_hash(const Game& game);
@@ -0,0 +1,30 @@
+#include "handoff.h"
+
+void handoff_init(SnapshotHandoff* handoff)
+{
+	handoff->write_index = 0;
+	handoff->shared = 1;
+	handoff->read_index = 2;
+}
+
+GameSnapshot* handoff_write_slot(SnapshotHandoff* handoff)
+{
+	return &handoff->slots[handoff->write_index];
+}
+
+void handoff_publish(SnapshotHandoff* handoff)
+{
+	uint32_t prev = handoff->shared.exchange(handoff->write_index | HANDOFF_FRESH, std::memory_order_acq_rel);
+	handoff->write_index = prev & ~HANDOFF_FRESH;
+}
+
+bool handoff_acquire(SnapshotHandoff* handoff, const GameSnapshot** snapshot)
+{
+	if (!(handoff->shared.load(std::memory_order_relaxed) & HANDOFF_FRESH))
+		return false;
+
+	uint32_t prev = handoff->shared.exchange(handoff->read_index, std::memory_order_acq_rel);
+	handoff->read_index = prev & ~HANDOFF_FRESH;
+	*snapshot = &handoff->slots[handoff->read_index];
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "game.h"
+#include "profile.h"
+
+// One published simulation state. Immutable once handed to the reader.
+struct GameSnapshot
+{
+	Game game;
+	uint64_t tick;
+	double time; // Seconds on the simulation clock when the tick ran
+	ProfileSummary profile; // Simulation stages over the last full second
+	// Counts ticks that applied key events; input_time is when the first
+	// event of the latest of them arrived, on the same clock as time
+	uint64_t input_serial;
+	double input_time;
+};
+
+// Lock-free triple buffer between one writer and one reader. The writer
+// always owns one slot and the reader another; the third is swapped with
+// either of them through one atomic exchange, so neither side ever waits
+// and the reader always gets the newest complete snapshot.
+struct SnapshotHandoff
+{
+	GameSnapshot slots[3];
+	// Index of the shared slot, plus HANDOFF_FRESH once the writer put a
+	// snapshot there that the reader has not taken yet
+	std::atomic<uint32_t> shared;
+	uint32_t write_index;
+	uint32_t read_index;
+};
+
+#define HANDOFF_FRESH 4u
+
+void handoff_init(SnapshotHandoff* handoff);
+
+// The writer's slot, fill it in and then call handoff_publish
+GameSnapshot* handoff_write_slot(SnapshotHandoff* handoff);
+void handoff_publish(SnapshotHandoff* handoff);
+
+// Swap in the newest published snapshot if there is one. Returns false
+// and leaves *snapshot alone when nothing new was published.
+bool handoff_acquire(SnapshotHandoff* handoff, const GameSnapshot** snapshot);
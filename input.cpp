@@ -0,0 +1,80 @@
+#include "input.h"
+
+void input_queue_init(InputQueue* queue)
+{
+	queue->head = 0;
+	queue->tail = 0;
+}
+
+bool input_queue_push(InputQueue* queue, InputKey key, bool pressed, double time)
+{
+	uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+	if (tail - queue->head.load(std::memory_order_acquire) == INPUT_QUEUE_SIZE)
+		return false;
+	InputEvent& event = queue->events[tail % INPUT_QUEUE_SIZE];
+	event.key = (uint8_t)key;
+	event.pressed = pressed;
+	event.time = time;
+	queue->tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+bool input_queue_pop(InputQueue* queue, InputEvent* event)
+{
+	uint32_t head = queue->head.load(std::memory_order_relaxed);
+	if (head == queue->tail.load(std::memory_order_acquire))
+		return false;
+	*event = queue->events[head % INPUT_QUEUE_SIZE];
+	queue->head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+void input_state_init(InputState* state)
+{
+	state->left = state->right = false;
+	state->left_tapped = state->right_tapped = false;
+	state->pending_fire = 0;
+	state->reset = state->game_over = false;
+	state->first_event_time = 0;
+}
+
+void input_drain(InputQueue* queue, InputState* state, Input* input)
+{
+	state->first_event_time = 0;
+	InputEvent event;
+	while (input_queue_pop(queue, &event))
+	{
+		if (state->first_event_time == 0)
+			state->first_event_time = event.time;
+		switch (event.key)
+		{
+		case INPUT_KEY_LEFT:
+			state->left = event.pressed;
+			state->left_tapped |= event.pressed;
+			break;
+		case INPUT_KEY_RIGHT:
+			state->right = event.pressed;
+			state->right_tapped |= event.pressed;
+			break;
+		case INPUT_KEY_FIRE:
+			if (event.pressed && state->pending_fire < INPUT_MAX_PENDING_FIRE)
+				state->pending_fire++;
+			break;
+		case INPUT_KEY_RESET:
+			state->reset |= event.pressed;
+			break;
+		case INPUT_KEY_GAME_OVER:
+			state->game_over |= event.pressed;
+			break;
+		}
+	}
+
+	input->move_dir = int(state->right || state->right_tapped) - int(state->left || state->left_tapped);
+	state->left_tapped = state->right_tapped = false;
+	input->fire = state->pending_fire > 0;
+	if (input->fire)
+		state->pending_fire--;
+	input->reset = state->reset;
+	input->game_over = state->game_over;
+	state->reset = state->game_over = false;
+}
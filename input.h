@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "game.h"
+
+// Key presses and releases travel from the window thread to the
+// simulation as timestamped events instead of shared flags, so nothing
+// that happens between two ticks is lost.
+enum InputKey
+{
+	INPUT_KEY_LEFT,
+	INPUT_KEY_RIGHT,
+	INPUT_KEY_FIRE,
+	INPUT_KEY_RESET,
+	INPUT_KEY_GAME_OVER
+};
+
+struct InputEvent
+{
+	uint8_t key;
+	bool pressed;
+	double time; // When the window system reported it, in seconds
+};
+
+// Single producer, single consumer ring. Events past a full ring are
+// dropped, 256 is several seconds of mashing.
+#define INPUT_QUEUE_SIZE 256
+
+struct InputQueue
+{
+	InputEvent events[INPUT_QUEUE_SIZE];
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> tail;
+};
+
+void input_queue_init(InputQueue* queue);
+bool input_queue_push(InputQueue* queue, InputKey key, bool pressed, double time);
+bool input_queue_pop(InputQueue* queue, InputEvent* event);
+
+// What the simulation remembers between ticks. A direction tapped and
+// released within one tick still moves the player for that tick. The
+// game fires at most one bullet per tick, so extra fire presses in a
+// tick are kept and served on the following ticks.
+#define INPUT_MAX_PENDING_FIRE 4
+
+struct InputState
+{
+	bool left, right; // Held
+	bool left_tapped, right_tapped; // Pressed since the last tick
+	uint32_t pending_fire;
+	bool reset, game_over;
+	double first_event_time; // Oldest event applied by the last tick, 0 for none
+};
+
+void input_state_init(InputState* state);
+
+// Applies every queued event and fills in the input for the next tick
+void input_drain(InputQueue* queue, InputState* state, Input* input);
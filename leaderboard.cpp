@@ -0,0 +1,265 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include "leaderboard.h"
+
+#define LEADERBOARD_HEADER_SIZE 8
+#define LEADERBOARD_RECORD_SIZE 24
+
+static uint32_t crc32(const uint8_t* data, size_t n)
+{
+	uint32_t crc = 0xffffffffu;
+	for (size_t i = 0; i < n; ++i)
+	{
+		crc ^= data[i];
+		for (int k = 0; k < 8; ++k)
+			crc = crc & 1 ? 0xedb88320u ^ (crc >> 1) : crc >> 1;
+	}
+	return ~crc;
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+	for (int i = 0; i < 4; ++i)
+		p[i] = uint8_t(v >> (8 * i));
+}
+
+static void put_record(uint8_t* p, const LeaderboardEntry& entry)
+{
+	put_u32(p, entry.score);
+	put_u32(p + 4, entry.level);
+	put_u32(p + 8, uint32_t(entry.time));
+	put_u32(p + 12, uint32_t(entry.time >> 32));
+	put_u32(p + 16, entry.sequence);
+	put_u32(p + 20, crc32(p, 20));
+}
+
+static bool get_record(const uint8_t* p, LeaderboardEntry* entry)
+{
+	if (get_u32(p + 20) != crc32(p, 20))
+		return false;
+	entry->score = get_u32(p);
+	entry->level = get_u32(p + 4);
+	entry->time = get_u32(p + 8) | ((uint64_t)get_u32(p + 12) << 32);
+	entry->sequence = get_u32(p + 16);
+	return true;
+}
+
+// Keeps top sorted by score, earlier games first on ties
+static void leaderboard_insert(Leaderboard* board, const LeaderboardEntry& entry)
+{
+	size_t i = board->num_top;
+	while (i > 0 && (board->top[i - 1].score < entry.score ||
+		(board->top[i - 1].score == entry.score && board->top[i - 1].sequence > entry.sequence)))
+		--i;
+	if (i == LEADERBOARD_SIZE)
+		return;
+	size_t last = board->num_top < LEADERBOARD_SIZE ? board->num_top : LEADERBOARD_SIZE - 1;
+	memmove(&board->top[i + 1], &board->top[i], (last - i) * sizeof(LeaderboardEntry));
+	board->top[i] = entry;
+	if (board->num_top < LEADERBOARD_SIZE)
+		board->num_top++;
+}
+
+static bool write_all(int fd, const uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = write(fd, data, size);
+		if (n <= 0) return false;
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool leaderboard_append(Leaderboard* board, const std::vector<LeaderboardEntry>& batch)
+{
+	std::vector<uint8_t> bytes(batch.size() * LEADERBOARD_RECORD_SIZE);
+	for (size_t i = 0; i < batch.size(); ++i)
+		put_record(&bytes[i * LEADERBOARD_RECORD_SIZE], batch[i]);
+
+	int fd = open(board->path.c_str(), O_WRONLY | O_APPEND);
+	if (fd < 0) return false;
+	bool ok = write_all(fd, bytes.data(), bytes.size()) && fsync(fd) == 0;
+	ok = close(fd) == 0 && ok;
+	return ok;
+}
+
+// Writes the top entries to a new file and renames it over the log, so
+// a crash leaves either the old log or the new one
+static bool leaderboard_compact(Leaderboard* board)
+{
+	std::vector<uint8_t> bytes(LEADERBOARD_HEADER_SIZE + board->num_top * LEADERBOARD_RECORD_SIZE);
+	memcpy(&bytes[0], "SILB", 4);
+	put_u32(&bytes[4], LEADERBOARD_VERSION);
+	for (size_t i = 0; i < board->num_top; ++i)
+		put_record(&bytes[LEADERBOARD_HEADER_SIZE + i * LEADERBOARD_RECORD_SIZE], board->top[i]);
+
+	std::string temp = board->path + ".tmp";
+	int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) return false;
+	bool ok = write_all(fd, bytes.data(), bytes.size()) && fsync(fd) == 0;
+	ok = close(fd) == 0 && ok;
+	ok = ok && rename(temp.c_str(), board->path.c_str()) == 0;
+
+	// Make the rename itself durable
+	size_t slash = board->path.rfind('/');
+	std::string dir = slash == std::string::npos ? "." : board->path.substr(0, slash + 1);
+	int dir_fd = open(dir.c_str(), O_RDONLY);
+	if (dir_fd >= 0)
+	{
+		fsync(dir_fd);
+		close(dir_fd);
+	}
+	return ok;
+}
+
+void leaderboard_load(Leaderboard* board, const char* path)
+{
+	board->path = path;
+	board->num_top = 0;
+	board->num_records = 0;
+	board->next_sequence = 0;
+	board->damaged = false;
+	board->running = false;
+	board->quit = false;
+	board->pending.clear();
+
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		// Carry over the high score of older versions
+		size_t slash = board->path.rfind('/');
+		std::string old = (slash == std::string::npos ? std::string() : board->path.substr(0, slash + 1)) + "score.dat";
+		FILE* old_file = fopen(old.c_str(), "rb");
+		uint8_t bytes[4];
+		if (old_file && fread(bytes, 1, 4, old_file) == 4 && get_u32(bytes) > 0)
+		{
+			LeaderboardEntry entry = { get_u32(bytes), 0, 0, board->next_sequence++ };
+			leaderboard_insert(board, entry);
+		}
+		if (old_file) fclose(old_file);
+		board->damaged = true; // Nothing to append to yet
+		return;
+	}
+
+	std::vector<uint8_t> data;
+	uint8_t chunk[4096];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		data.insert(data.end(), chunk, chunk + n);
+	fclose(file);
+
+	if (data.size() < LEADERBOARD_HEADER_SIZE || memcmp(&data[0], "SILB", 4) != 0 ||
+		get_u32(&data[4]) != LEADERBOARD_VERSION)
+	{
+		fprintf(stderr, "Error: %s is not a version %d leaderboard, starting a new one\n", path, LEADERBOARD_VERSION);
+		board->damaged = true;
+		return;
+	}
+
+	// Everything up to the first damaged or torn record counts
+	size_t pos = LEADERBOARD_HEADER_SIZE;
+	for (; pos + LEADERBOARD_RECORD_SIZE <= data.size(); pos += LEADERBOARD_RECORD_SIZE)
+	{
+		LeaderboardEntry entry;
+		if (!get_record(&data[pos], &entry))
+			break;
+		leaderboard_insert(board, entry);
+		board->num_records++;
+		if (entry.sequence >= board->next_sequence)
+			board->next_sequence = entry.sequence + 1;
+	}
+	if (pos != data.size())
+	{
+		fprintf(stderr, "Leaderboard %s: dropped %zu damaged bytes\n", path, data.size() - pos);
+		board->damaged = true;
+	}
+}
+
+static void leaderboard_thread(Leaderboard* board)
+{
+	std::unique_lock<std::mutex> lock(board->mutex);
+	for (;;)
+	{
+		while (board->pending.empty() && !board->quit)
+			board->cv.wait(lock);
+		if (board->pending.empty())
+			break;
+
+		// Give more submissions a moment to arrive, then write them together
+		std::chrono::steady_clock::time_point until =
+			std::chrono::steady_clock::now() + std::chrono::milliseconds(LEADERBOARD_BATCH_MS);
+		while (!board->quit && board->cv.wait_until(lock, until) != std::cv_status::timeout) {}
+
+		std::vector<LeaderboardEntry> batch;
+		batch.swap(board->pending);
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			batch[i].sequence = board->next_sequence++;
+			leaderboard_insert(board, batch[i]);
+		}
+		bool compact = board->damaged || board->num_records + batch.size() >= LEADERBOARD_COMPACT_AT;
+		lock.unlock();
+
+		// Only this thread changes top, so it can be read unlocked here
+		bool ok = compact ? leaderboard_compact(board) : leaderboard_append(board, batch);
+		if (!ok)
+			fprintf(stderr, "Error: could not write leaderboard %s\n", board->path.c_str());
+
+		lock.lock();
+		if (ok)
+			board->num_records = compact ? board->num_top : board->num_records + batch.size();
+		board->damaged = !ok;
+	}
+}
+
+void leaderboard_start(Leaderboard* board)
+{
+	board->running = true;
+	board->writer = std::thread(leaderboard_thread, board);
+}
+
+void leaderboard_close(Leaderboard* board)
+{
+	if (!board->running)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(board->mutex);
+		board->quit = true;
+		board->cv.notify_one();
+	}
+	board->writer.join();
+	board->running = false;
+}
+
+void leaderboard_submit(Leaderboard* board, uint32_t score, uint32_t level)
+{
+	LeaderboardEntry entry = { score, level, (uint64_t)std::time(NULL), 0 };
+	std::lock_guard<std::mutex> lock(board->mutex);
+	board->pending.push_back(entry);
+	board->cv.notify_one();
+}
+
+size_t leaderboard_top(Leaderboard* board, LeaderboardEntry* entries, size_t n)
+{
+	std::lock_guard<std::mutex> lock(board->mutex);
+	if (n > board->num_top) n = board->num_top;
+	memcpy(entries, board->top, n * sizeof(LeaderboardEntry));
+	return n;
+}
+
+uint32_t leaderboard_high_score(Leaderboard* board)
+{
+	std::lock_guard<std::mutex> lock(board->mutex);
+	return board->num_top ? board->top[0].score : 0;
+}
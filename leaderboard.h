@@ -0,0 +1,73 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Finished games, kept in an append-only log:
+//
+//   0  "SILB"
+//   4  u32 version
+//   8  records of 24 bytes:
+//        0  u32 score
+//        4  u32 level
+//        8  u64 unix time
+//       16  u32 sequence number
+//       20  u32 CRC-32 of the 20 bytes before it
+//
+// All little endian. A record is only trusted if its checksum matches, so
+// a crash in the middle of an append loses that record and nothing else.
+// Once the log holds LEADERBOARD_COMPACT_AT records, or reading it hit a
+// damaged one, it is rewritten with just the top LEADERBOARD_SIZE into a
+// temporary file that then replaces it with an atomic rename.
+
+#define LEADERBOARD_VERSION 1
+#define LEADERBOARD_SIZE 10
+#define LEADERBOARD_COMPACT_AT 256
+// How long the writer collects submissions before one append and fsync
+#define LEADERBOARD_BATCH_MS 200
+
+struct LeaderboardEntry
+{
+	uint32_t score;
+	uint32_t level;
+	uint64_t time;
+	uint32_t sequence;
+};
+
+struct Leaderboard
+{
+	std::string path;
+	// Best first, at most LEADERBOARD_SIZE
+	LeaderboardEntry top[LEADERBOARD_SIZE];
+	size_t num_top;
+	size_t num_records; // In the file
+	uint32_t next_sequence;
+	bool damaged; // The file needs rewriting before the next append
+
+	// Submissions waiting for the writer thread
+	std::vector<LeaderboardEntry> pending;
+	bool running, quit;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::thread writer;
+};
+
+// Reads the log at path. A missing log starts empty, or from the high
+// score in a score.dat from older versions next to it.
+void leaderboard_load(Leaderboard* board, const char* path);
+// Starts the writer thread, needed before leaderboard_submit
+void leaderboard_start(Leaderboard* board);
+// Writes out anything pending and stops the writer thread
+void leaderboard_close(Leaderboard* board);
+
+// Queues a finished game. Only takes a lock for a push_back, the file
+// is written later by the writer thread.
+void leaderboard_submit(Leaderboard* board, uint32_t score, uint32_t level);
+
+// Copies up to n of the best entries, returns how many
+size_t leaderboard_top(Leaderboard* board, LeaderboardEntry* entries, size_t n);
+uint32_t leaderboard_high_score(Leaderboard* board);
@@ -1,30 +1,95 @@
 #include <cstdio>
 #include <cstdint>
-#include <limits>
 #include <iostream>
-#include <fstream>
 #include <sstream>
 #include <string>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#ifndef HEADLESS
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
-#include <irrKlang.h>
+#endif
+#include "audio.h"
+#include "game.h"
+#include "input.h"
+#include "leaderboard.h"
+#include "render.h"
+#include "replay.h"
+#include "savestate.h"
+#include "profile.h"
+#ifdef HEADLESS
+#include "batch.h"
+#include "framedump.h"
+#else
+#include "handoff.h"
+#include "upload.h"
+#include "pacing.h"
+#endif
 
-#define ASSERT(x) if (!(x)) __debugbreak();
 #define GAME_NAME "Space Invaders"
 #define VERSION "v0.1"
 
-bool game_running = false;
-int move_dir = 0;
-bool fire_pressed = 0;
-bool reset = 0;
-bool game_over = false;
+// Written by the key callback, read by the simulation thread. Game keys
+// go through input_queue, see input.h.
+std::atomic<bool> game_running(false);
+std::atomic<bool> rewind_held(false);
+InputQueue input_queue;
 int screen_width = 0;
 int screen_height = 0;
 bool window_resize = true;
 bool render = true;
+bool show_profile = false;
+bool cycle_pacing = false;
+
+// NULL when running silent
+Audio* audio = NULL;
+// Mapped asset bundle, data is NULL without one
+Bundle assets;
+// Replaces the score.dat of older versions, windowed build only
+Leaderboard* leaderboard = NULL;
+const char* leaderboard_path = "scores.log";
+
+void open_audio(const AudioBackend& backend, const char* output_path)
+{
+	audio = new Audio;
+	if (!audio_init(audio, backend, output_path, assets.data ? &assets : NULL))
+	{
+		fprintf(stderr, "Running without sound\n");
+		audio_free(audio);
+		delete audio;
+		audio = NULL;
+	}
+}
+
+void close_audio()
+{
+	if (!audio) return;
+	audio_free(audio);
+	delete audio;
+	audio = NULL;
+}
 
-irrklang::ISoundEngine* SoundEngine = irrklang::createIrrKlangDevice();
+void play_event_sounds(const Game& game, size_t* move_audio_i)
+{
+	if (game.events & GAME_EVENT_PLAYER_HIT)
+		audio_play(audio, AUDIO_EXPLOSION);
+	if (game.events & GAME_EVENT_ALIEN_KILLED)
+		audio_play(audio, AUDIO_INVADER_KILLED);
+	if (game.events & GAME_EVENT_ALIEN_MOVE)
+	{
+		audio_play(audio, AudioSound(AUDIO_MOVE1 + *move_audio_i));
+		(*move_audio_i)++;
+		if (*move_audio_i == 4)
+			*move_audio_i = 0;
+	}
+	if (game.events & GAME_EVENT_PLAYER_SHOOT)
+		audio_play(audio, AUDIO_PLAYER_SHOOT);
+}
 
+#ifndef HEADLESS
 #define GL_ERROR_CASE(glerror)\
     case glerror: snprintf(error, sizeof(error), "%s", #glerror)
 
@@ -93,21 +158,29 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 		if (action == GLFW_PRESS) game_running = false;
 		break;
 	case GLFW_KEY_RIGHT:
-		if (action == GLFW_PRESS) move_dir += 1;
-		else if (action == GLFW_RELEASE) move_dir -= 1;
-		break;
 	case GLFW_KEY_LEFT:
-		if (action == GLFW_PRESS) move_dir -= 1;
-		else if (action == GLFW_RELEASE) move_dir += 1;
-		break;
 	case GLFW_KEY_SPACE:
-		if (action == GLFW_RELEASE) fire_pressed = true;
-		break;
 	case GLFW_KEY_R:
-		if (action == GLFW_RELEASE) reset = true;
-		break;
 	case GLFW_KEY_G:
-		if (action == GLFW_RELEASE) game_over = true;
+		if (action == GLFW_PRESS || action == GLFW_RELEASE)
+		{
+			InputKey input_key =
+				key == GLFW_KEY_RIGHT ? INPUT_KEY_RIGHT :
+				key == GLFW_KEY_LEFT ? INPUT_KEY_LEFT :
+				key == GLFW_KEY_SPACE ? INPUT_KEY_FIRE :
+				key == GLFW_KEY_R ? INPUT_KEY_RESET : INPUT_KEY_GAME_OVER;
+			input_queue_push(&input_queue, input_key, action == GLFW_PRESS, glfwGetTime());
+		}
+		break;
+	case GLFW_KEY_P:
+		if (action == GLFW_RELEASE) show_profile = !show_profile;
+		break;
+	case GLFW_KEY_F:
+		if (action == GLFW_RELEASE) cycle_pacing = true;
+		break;
+	case GLFW_KEY_BACKSPACE:
+		if (action == GLFW_PRESS) rewind_held = true;
+		else if (action == GLFW_RELEASE) rewind_held = false;
 		break;
 	default:
 		break;
@@ -119,206 +192,549 @@ void window_size_callback(GLFWwindow* window, int width, int height)
 	screen_height = height;
 	window_resize = true;
 }
+#endif
 
-struct High_Score
+#ifndef HEADLESS
+struct SimulationIO
 {
-	uint32_t hs;
+	ReplayWriter* recording;
+	ReplayReader* replay; // Set to NULL by the simulation once it ran out
+	size_t replay_speed; // Ticks per 60 Hz step while replaying
+	Profiler* profiler; // Owned by the simulation thread until it exits
+	Leaderboard* leaderboard; // NULL while replaying, those games do not count
 };
-void read_high_score(High_Score& high_score)
-{
-	std::ifstream in("score.dat");
-	if (in.good())
-		in.read((char*)&high_score, sizeof(high_score));
-	else
-		high_score.hs = 0;
-	in.close();
-}
-void write_high_score(High_Score& high_score)
+
+// Steps the game at 60 ticks/s on its own clock and publishes every tick.
+// Input comes from the key events queued since the last tick, or from the
+// replay until it runs out. Holding backspace steps back through the last
+// ten seconds instead, unless recording or replaying.
+void simulation_thread(Game* game, SnapshotHandoff* handoff, SimulationIO* io)
 {
-	std::ofstream out("score.dat");
-	if (out.good())
-		out.write((char*)&high_score, sizeof(high_score));
-	out.close();
+	const double tick = 1.0 / 60.0;
+	size_t move_audio_i = 0;
+	uint64_t ticks = 0;
+	Input input = Input();
+	InputState input_state;
+	input_state_init(&input_state);
+	uint64_t input_serial = 0;
+	double input_time = 0;
+	StateRing history;
+	state_ring_init(&history, 600);
+	profiler = io->profiler;
+	ProfileSummary profile_summary = ProfileSummary();
+	double next = glfwGetTime();
+	double profile_timer = next;
+	while (game_running)
+	{
+		bool rewinding = rewind_held && !io->recording && !io->replay;
+		if (rewinding)
+		{
+			// Keys pressed while rewinding or replaying are dropped
+			Input ignored;
+			input_drain(&input_queue, &input_state, &ignored);
+			state_ring_rewind(&history, 0, *game);
+		}
+		size_t steps = rewinding ? 0 : (io->replay ? io->replay_speed : 1);
+		for (size_t i = 0; i < steps; ++i)
+		{
+			state_ring_push(&history, *game);
+			if (io->replay && !replay_read_tick(io->replay, &input))
+			{
+				bool match = game_hash(*game) == io->replay->header.final_hash;
+				printf("Replay ended after %llu ticks, final state %s\n",
+					(unsigned long long)io->replay->ticks, match ? "matches" : "DOES NOT MATCH");
+				replay_close_read(io->replay);
+				delete io->replay;
+				io->replay = NULL;
+			}
+			if (io->replay)
+			{
+				Input ignored;
+				input_drain(&input_queue, &input_state, &ignored);
+			}
+			else
+			{
+				input_drain(&input_queue, &input_state, &input);
+				if (input_state.first_event_time > 0)
+				{
+					input_serial++;
+					input_time = input_state.first_event_time;
+				}
+			}
+			game_step(*game, input);
+			profile_commit(profiler);
+			if (io->leaderboard && (game->events & GAME_EVENT_GAME_OVER))
+				leaderboard_submit(io->leaderboard, uint32_t(game->score), uint32_t(game->level));
+			if (io->recording)
+				replay_write_tick(io->recording, input);
+			play_event_sounds(*game, &move_audio_i);
+			audio_advance(audio);
+			++ticks;
+		}
+
+		GameSnapshot* snapshot = handoff_write_slot(handoff);
+		snapshot->game = *game;
+		snapshot->tick = ticks;
+		snapshot->time = glfwGetTime();
+		if (snapshot->time - profile_timer > 1.0)
+		{
+			profile_timer = snapshot->time;
+			profile_summarize(profiler, &profile_summary);
+		}
+		snapshot->profile = profile_summary;
+		snapshot->input_serial = input_serial;
+		snapshot->input_time = input_time;
+		handoff_publish(handoff);
+
+		// Catch up after a stall, but drop anything over a quarter second
+		next += tick;
+		double now = glfwGetTime();
+		if (now - next > 0.25) next = now;
+		if (next > now)
+			std::this_thread::sleep_for(std::chrono::duration<double>(next - now));
+	}
+	state_ring_free(&history);
 }
+#endif
 
-/* Algorithm "xor" from p. 4 of Marsaglia, "Xorshift RNGs" */
-uint32_t xorshift32(uint32_t* rng)
+#ifdef HEADLESS
+// Stands in for key_callback when there is no window: wander left and
+// right, fire every few ticks and restart as soon as the game is over
+// so a soak run never stalls on the GAME OVER screen.
+void headless_input(uint32_t* rng, bool is_game_over, Input& input)
 {
-	uint32_t x = *rng;
-	x ^= x << 13;
-	x ^= x >> 17;
-	x ^= x << 5;
-	*rng = x;
-	return x;
+	uint32_t r = xorshift32(rng);
+	if (r % 32 == 0)
+		input.move_dir = int((r >> 8) % 3) - 1;
+	input.fire = r % 8 == 0;
+	input.reset = is_game_over;
+	input.game_over = false;
 }
 
-double random(uint32_t* rng)
+void headless_batch_policy(size_t index, const Game& game, Input& input, void* user)
 {
-	return (double)xorshift32(rng) / std::numeric_limits<uint32_t>::max();
+	uint32_t* input_rngs = (uint32_t*)user;
+	headless_input(&input_rngs[index], game.player.life == 0, input);
 }
 
-struct Buffer
+// Step num_games independent games for `ticks` ticks each on a thread pool
+int run_batch(size_t num_games, size_t num_threads, size_t ticks, size_t width, size_t height)
 {
-	size_t width, height;
-	uint32_t* data;
-};
+	BatchSim batch;
+	batch_init(&batch, num_games, width, height, 13, num_threads);
 
-struct Sprite
-{
-	size_t width, height;
-	uint32_t color;
-	uint8_t* data;
-};
+	uint32_t* input_rngs = new uint32_t[num_games];
+	for (size_t i = 0; i < num_games; ++i)
+		input_rngs[i] = 7 + 2 * i;
+	batch.policy = headless_batch_policy;
+	batch.policy_user = input_rngs;
 
-struct Alien
-{
-	size_t x, y;
-	size_t type;
-};
+	printf("Batch: %zu games on %zu threads\n", num_games, batch.num_threads);
 
-struct Bullet
-{
-	size_t x, y;
-	int dir;
-};
+	// Step in slices so progress shows up on long runs
+	const size_t slice = 1000;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t done = 0; done < ticks; )
+	{
+		size_t n = ticks - done < slice ? ticks - done : slice;
+		batch_step(&batch, n);
+		done += n;
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	size_t total_ticks = num_games * ticks;
+	size_t max_level = 0;
+	for (size_t i = 0; i < num_games; ++i)
+		if (batch.games[i].level > max_level) max_level = batch.games[i].level;
+	printf("Ticks: %zu in %.3f s (%.0f ticks/s, %.0f ticks/s per thread)\n",
+		total_ticks, elapsed, total_ticks / elapsed, total_ticks / elapsed / batch.num_threads);
+	printf("Max Level: %zu\n", max_level);
+
+	batch_free(&batch);
+	delete[] input_rngs;
+	return 0;
+}
 
-struct Player
+// Re-simulate a replay as fast as possible and check its final state.
+// Only replays of a width x height game are accepted, the buffer is
+// sized from the header.
+int run_replay(const char* path, bool draw, size_t width, size_t height)
 {
-	size_t x, y;
-	size_t life;
-};
+	ReplayReader replay;
+	if (!replay_open_read(&replay, path))
+		return 1;
 
-#define GAME_MAX_BULLETS 128
+	const ReplayHeader& header = replay.header;
+	if (header.width != width || header.height != height)
+	{
+		fprintf(stderr, "Error: %s was recorded at %ux%u, not %zux%zu\n",
+			path, header.width, header.height, width, height);
+		replay_close_read(&replay);
+		return 1;
+	}
+	Game* game = new Game;
+	game_init(*game, header.width, header.height, header.seed, header.high_score);
 
-struct Game
-{
-	size_t width, height;
-	size_t num_aliens;
-	size_t num_bullets;
-	Alien* aliens;
-	Player player;
-	Bullet bullets[GAME_MAX_BULLETS];
-};
+	Buffer buffer = { header.width, header.height, new uint32_t[header.width * header.height] };
+	Renderer* renderer = new Renderer;
+	renderer_init(renderer, &buffer);
 
-struct SpriteAnimation
-{
-	bool loop;
-	size_t num_frames;
-	size_t frame_duration;
-	size_t time;
-	Sprite** frames;
-};
+	Input input;
+	size_t move_audio_i = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (replay_read_tick(&replay, &input))
+	{
+		game_step(*game, input);
+		play_event_sounds(*game, &move_audio_i);
+		audio_advance(audio);
+		if (draw)
+			game_draw(renderer, *game);
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t hash = game_hash(*game);
+	bool ok = replay.ticks == header.ticks && hash == header.final_hash;
+	printf("Replay: %llu of %llu ticks in %.3f s (%.0f ticks/s)\n",
+		(unsigned long long)replay.ticks, (unsigned long long)header.ticks, elapsed, replay.ticks / elapsed);
+	printf("Level: %zu Score: %zu High Score: %u\n", game->level, game->score, game->high_score);
+	printf("Final hash: %016llx expected %016llx %s\n",
+		(unsigned long long)hash, (unsigned long long)header.final_hash, ok ? "OK" : "MISMATCH");
+
+	renderer_free(renderer);
+	delete renderer;
+	delete[] buffer.data;
+	delete game;
+	replay_close_read(&replay);
+	return ok ? 0 : 1;
+}
 
-enum AlienType : uint8_t
+void headless_rollout_policy(const Game& game, Input& input, uint32_t* rng)
 {
-	ALIEN_DEAD = 0,
-	ALIEN_TYPE_A = 1,
-	ALIEN_TYPE_B = 2,
-	ALIEN_TYPE_C = 3
-};
+	headless_input(rng, game.player.life == 0, input);
+}
 
-void buffer_clear(Buffer* buffer, uint32_t color)
+// Cost of a save and a restore, a rewind-and-replay determinism check and
+// a batch of Monte Carlo rollouts from the final state
+int run_snapshot_bench(size_t ticks, size_t width, size_t height)
 {
-	for (size_t i = 0; i < buffer->width * buffer->height; ++i)
+	const size_t history = 600;
+	StateRing ring;
+	state_ring_init(&ring, history);
+	Input* inputs = new Input[history];
+
+	Game* game = new Game;
+	game_init(*game, width, height);
+	uint32_t input_rng = 7;
+	Input input = Input();
+	for (size_t t = 0; t < ticks; ++t)
+	{
+		headless_input(&input_rng, game->player.life == 0, input);
+		state_ring_push(&ring, *game);
+		inputs[t % history] = input;
+		game_step(*game, input);
+	}
+	uint64_t hash = game_hash(*game);
+
+	// Rewind half the history and step the same inputs again
+	size_t back = (ticks < history ? ticks : history) / 2;
+	Game* branch = new Game;
+	bool ok = back > 0 && state_ring_rewind(&ring, back - 1, *branch);
+	for (size_t t = ticks - back; ok && t < ticks; ++t)
+		game_step(*branch, inputs[t % history]);
+	ok = ok && game_hash(*branch) == hash;
+	printf("Rewind %zu ticks and replay: %s\n", back, ok ? "OK" : "MISMATCH");
+
+	const size_t copies = 1000000;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < copies; ++i)
 	{
-		buffer->data[i] = color;
+		state_ring_push(&ring, *game);
+		state_ring_rewind(&ring, 0, *branch);
 	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("Save + restore of %zu bytes: %.1f ns\n", sizeof(Game), elapsed * 1e9 / copies);
+
+	const size_t rollouts = 256, rollout_ticks = 600;
+	start = std::chrono::steady_clock::now();
+	double mean = game_rollouts(*game, rollouts, rollout_ticks, headless_rollout_policy, 1);
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("Rollouts: %zu x %zu ticks in %.3f s, mean score gained %.1f\n", rollouts, rollout_ticks, elapsed, mean);
+
+	delete branch;
+	delete game;
+	delete[] inputs;
+	state_ring_free(&ring);
+	return ok ? 0 : 1;
 }
 
-bool sprite_overlap_check(
-	const Sprite& sp_a, size_t x_a, size_t y_a,
-	const Sprite& sp_b, size_t x_b, size_t y_b
-)
+// Time buffer_draw_sprite against the original per-pixel loop on the same
+// draws: every game sprite and glyph at random spots, some hanging off
+// the edges. Also checks that both leave identical buffers.
+typedef void (*DrawSpriteFn)(Buffer*, const Sprite&, size_t, size_t, uint32_t);
+
+int run_sprite_bench(size_t num_draws, size_t width, size_t height)
 {
-	// NOTE: For simplicity we just check for overlap of the sprite
-	// rectangles. Instead, if the rectangles overlap, we should
-	// further check if any pixel of sprite A overlap with any of
-	// sprite B.
-	if (x_a < x_b + sp_b.width && x_a + sp_a.width > x_b &&
-		y_a < y_b + sp_b.height && y_a + sp_a.height > y_b)
+	const size_t set_size = 1024;
+	Sprite sprites[set_size];
+	size_t xs[set_size], ys[set_size];
+
+	const Sprite* pool[] = {
+		&alien_sprites[0], &alien_sprites[1], &alien_sprites[2], &alien_sprites[3],
+		&alien_sprites[4], &alien_sprites[5], &alien_death_sprite, &player_sprite,
+		&player_bullet_sprite, &alien_bullet_sprite[0], &alien_bullet_sprite[1], &text_spritesheet
+	};
+	const size_t pool_size = sizeof(pool) / sizeof(pool[0]);
+
+	uint32_t rng = 13;
+	for (size_t i = 0; i < set_size; ++i)
 	{
-		return true;
+		sprites[i] = *pool[xorshift32(&rng) % pool_size];
+		if (sprites[i].data == text_spritesheet.data)
+		{
+			size_t glyph = xorshift32(&rng) % 65;
+			sprites[i].data += glyph * sprites[i].width * sprites[i].height;
+			sprites[i].masks += glyph * sprites[i].height;
+		}
+		xs[i] = size_t(int(xorshift32(&rng) % (width + 16)) - 8);
+		ys[i] = size_t(int(xorshift32(&rng) % (height + 16)) - 8);
 	}
 
-	return false;
-}
+	Buffer buffers[2];
+	DrawSpriteFn fns[2] = { buffer_draw_sprite_bytes, buffer_draw_sprite };
+	const char* names[2] = { "per-pixel", "row masks" };
+	size_t passes = num_draws / set_size ? num_draws / set_size : 1;
+	for (int f = 0; f < 2; ++f)
+	{
+		buffers[f].width = width;
+		buffers[f].height = height;
+		buffers[f].data = new uint32_t[width * height];
+		buffer_clear(&buffers[f], 0);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t p = 0; p < passes; ++p)
+		{
+			uint32_t color = uint32_t(p + 1);
+			for (size_t i = 0; i < set_size; ++i)
+				fns[f](&buffers[f], sprites[i], xs[i], ys[i], color);
+		}
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("%s: %zu sprites in %.3f s (%.1f ns/sprite)\n",
+			names[f], passes * set_size, elapsed, elapsed * 1e9 / (passes * set_size));
+	}
 
-void buffer_draw_sprite(Buffer* buffer, const Sprite& sprite, size_t x, size_t y, uint32_t color = 0)
+	bool same = std::equal(buffers[0].data, buffers[0].data + width * height, buffers[1].data);
+	printf("Buffers %s\n", same ? "match" : "DIFFER");
+	delete[] buffers[0].data;
+	delete[] buffers[1].data;
+	return same ? 0 : 1;
+}
+// Draws the same game through the dirty-tile renderer and through one
+// that redraws everything each frame, on the game's buffer and on ones
+// too big for RENDER_MAX_TILES. Checks that every rect handed out lies
+// inside the buffer and that both renderers leave the same pixels.
+int run_render_check(size_t ticks)
 {
-	if (!color)
-		color = sprite.color;
-	for (size_t xi = 0; xi < sprite.width; ++xi)
+	const size_t sizes[][2] = { { 224, 256 }, { 600, 600 }, { 224, 3000 }, { 2048, 2048 } };
+	bool ok = true;
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
 	{
-		for (size_t yi = 0; yi < sprite.height; ++yi)
+		size_t width = sizes[s][0], height = sizes[s][1];
+		Game* game = new Game;
+		game_init(*game, width, height);
+		Buffer buffers[2];
+		Renderer* renderers[2];
+		for (int r = 0; r < 2; ++r)
+		{
+			buffers[r].width = width;
+			buffers[r].height = height;
+			buffers[r].data = new uint32_t[width * height];
+			buffer_clear(&buffers[r], 0);
+			renderers[r] = new Renderer;
+			renderer_init(renderers[r], &buffers[r]);
+		}
+
+		Input input = Input();
+		uint32_t input_rng = 7;
+		size_t bad_rects = 0, first_area = 0, bad_frames = 0;
+		for (size_t t = 0; t < ticks; ++t)
 		{
-			if (sprite.data[yi * sprite.width + xi] &&
-				(sprite.height - 1 + y - yi) < buffer->height &&
-				(x + xi) < buffer->width)
+			headless_input(&input_rng, game->player.life == 0, input);
+			game_step(*game, input);
+			renderers[1]->redraw_all = true;
+			for (int r = 0; r < 2; ++r)
+				game_draw(renderers[r], *game);
+
+			size_t num_rects = renderer_take_rects(renderers[0]);
+			renderer_take_rects(renderers[1]);
+			for (size_t i = 0; i < num_rects; ++i)
 			{
-				buffer->data[(sprite.height - 1 + y - yi) * buffer->width + (x + xi)] = color;
+				const DirtyRect& rect = renderers[0]->rects[i];
+				if (rect.width == 0 || rect.height == 0 ||
+					rect.x + rect.width > width || rect.y + rect.height > height)
+					++bad_rects;
+				if (t == 0)
+					first_area += rect.width * rect.height;
 			}
+			if (!std::equal(buffers[0].data, buffers[0].data + width * height, buffers[1].data))
+				++bad_frames;
 		}
-	}
-}
 
-void buffer_draw_number(
-	Buffer* buffer,
-	const Sprite& number_spritesheet, size_t number,
-	size_t x, size_t y,
-	uint32_t color)
-{
-	uint8_t digits[64];
-	size_t num_digits = 0;
+		// The first frame redraws everything, in rects that do not overlap
+		bool size_ok = bad_rects == 0 && bad_frames == 0 && first_area == width * height;
+		printf("%zux%zu: %zux%zu tiles, %zu bad rects, first frame %zu of %zu pixels, %zu differing frames %s\n",
+			width, height, renderers[0]->tiles_x, renderers[0]->tiles_y, bad_rects,
+			first_area, width * height, bad_frames, size_ok ? "OK" : "FAILED");
+		ok = ok && size_ok;
 
-	size_t current_number = number;
-	do
-	{
-		digits[num_digits++] = current_number % 10;
-		current_number = current_number / 10;
-	} while (current_number > 0);
-
-	size_t xp = x;
-	size_t stride = number_spritesheet.width * number_spritesheet.height;
-	Sprite sprite = number_spritesheet;
-	for (size_t i = 0; i < num_digits; ++i)
-	{
-		uint8_t digit = digits[num_digits - i - 1];
-		sprite.data = number_spritesheet.data + digit * stride;
-		buffer_draw_sprite(buffer, sprite, xp, y, color);
-		xp += sprite.width + 1;
+		for (int r = 0; r < 2; ++r)
+		{
+			renderer_free(renderers[r]);
+			delete renderers[r];
+			delete[] buffers[r].data;
+		}
+		delete game;
 	}
+	return ok ? 0 : 1;
 }
+#endif
 
-void buffer_draw_text(
-	Buffer* buffer,
-	const Sprite& text_spritesheet,
-	const char* text,
-	size_t x, size_t y,
-	uint32_t color)
+int main(int argc, char* argv[])
 {
-	size_t xp = x;
-	size_t stride = text_spritesheet.width * text_spritesheet.height;
-	Sprite sprite = text_spritesheet;
-	for (const char* charp = text; *charp != '\0'; ++charp)
+	const size_t buffer_width = 224;
+	const size_t buffer_height = 256;
+	const char* record_path = NULL;
+	const char* replay_path = NULL;
+	const char* profile_path = NULL;
+	const char* audio_path = NULL;
+	std::string assets_path = bundle_default_path(argv[0]);
+
+#ifdef HEADLESS
+	// Usage: main_headless [ticks] [--render] [--record file]
+	//        main_headless --replay file [--render]
+	//        main_headless [ticks] [--render] --profile file.csv
+	//        main_headless [ticks] --audio-wav file.wav
+	//        main_headless [ticks] --dump frames.{raw,png,y4m} [--dump-every n]
+	//        main_headless [ticks] --batch games [--threads n]
+	//        main_headless [draws] --bench-sprites
+	//        main_headless [ticks] --bench-snapshots
+	//        main_headless [ticks] --check-render
+	size_t max_ticks = 1000000;
+	const char* dump_path = NULL;
+	size_t dump_every = 1;
+	size_t batch_games = 0;
+	size_t batch_threads = 0;
+	bool bench_sprites = false;
+	bool check_render = false;
+	bool bench_snapshots = false;
+	render = false;
+	for (int i = 1; i < argc; ++i)
 	{
-		char character = *charp - 32;
-		if (character < 0 || character >= 65) continue;
+		std::string arg = argv[i];
+		if (arg == "--render")
+			render = true;
+		else if (arg == "--batch" && i + 1 < argc)
+			batch_games = std::strtoull(argv[++i], NULL, 10);
+		else if (arg == "--threads" && i + 1 < argc)
+			batch_threads = std::strtoull(argv[++i], NULL, 10);
+		else if (arg == "--bench-sprites")
+			bench_sprites = true;
+		else if (arg == "--check-render")
+			check_render = true;
+		else if (arg == "--bench-snapshots")
+			bench_snapshots = true;
+		else if (arg == "--record" && i + 1 < argc)
+			record_path = argv[++i];
+		else if (arg == "--replay" && i + 1 < argc)
+			replay_path = argv[++i];
+		else if (arg == "--profile" && i + 1 < argc)
+			profile_path = argv[++i];
+		else if (arg == "--audio-wav" && i + 1 < argc)
+			audio_path = argv[++i];
+		else if (arg == "--assets" && i + 1 < argc)
+			assets_path = argv[++i];
+		else if (arg == "--dump" && i + 1 < argc)
+			dump_path = argv[++i];
+		else if (arg == "--dump-every" && i + 1 < argc)
+			dump_every = std::strtoull(argv[++i], NULL, 10);
+		else
+			max_ticks = std::strtoull(argv[i], NULL, 10);
+	}
+
+	if (bench_snapshots)
+		return run_snapshot_bench(max_ticks, buffer_width, buffer_height);
+	if (check_render)
+		return run_render_check(max_ticks);
+	if (bench_sprites)
+		return run_sprite_bench(max_ticks, buffer_width, buffer_height);
+	if (batch_games > 0)
+		return run_batch(batch_games, batch_threads, max_ticks, buffer_width, buffer_height);
+
+	// Silent unless asked to render the sound to a file
+	bundle_open(&assets, assets_path.c_str());
+	open_audio(audio_path ? audio_backend_offline : audio_backend_null, audio_path);
 
-		sprite.data = text_spritesheet.data + character * stride;
-		buffer_draw_sprite(buffer, sprite, xp, y, color);
-		xp += sprite.width + 1;
+	if (replay_path)
+	{
+		int result = run_replay(replay_path, render, buffer_width, buffer_height);
+		close_audio();
+		bundle_close(&assets);
+		return result;
 	}
-}
 
-uint32_t rgb_to_uint32(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255)
-{
-	return (r << 24) | (g << 16) | (b << 8) | a;
-}
+	// Create graphics buffer
+	Buffer buffer;
+	buffer.width = buffer_width;
+	buffer.height = buffer_height;
+	buffer.data = new uint32_t[buffer.width * buffer.height];
 
-int main(int argc, char* argv[])
-{
-	const size_t buffer_width = 224;
-	const size_t buffer_height = 256;
+	buffer_clear(&buffer, 0);
+
+	Renderer* renderer = new Renderer;
+	renderer_init(renderer, &buffer);
+
+	// Dumped frames are rendered ones
+	FrameDump* dump = NULL;
+	if (dump_path)
+	{
+		render = true;
+		if (dump_every == 0) dump_every = 1;
+		dump = new FrameDump;
+		if (!frame_dump_open(dump, dump_path, frame_dump_format(dump_path), buffer.width, buffer.height))
+		{
+			delete dump;
+			dump = NULL;
+		}
+	}
+#else
+	// Usage: main [--record file] [--replay file [--speed n]] [--profile file.csv]
+	//            [--mute | --audio-wav file.wav] [--pacing off|vsync|cap[:fps]|adaptive]
+	size_t replay_speed = 1;
+	bool mute = false;
+	PacingMode pacing_mode = PACING_ADAPTIVE;
+	double pacing_cap = 60;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--record" && i + 1 < argc)
+			record_path = argv[++i];
+		else if (arg == "--replay" && i + 1 < argc)
+			replay_path = argv[++i];
+		else if (arg == "--speed" && i + 1 < argc)
+			replay_speed = std::strtoull(argv[++i], NULL, 10);
+		else if (arg == "--profile" && i + 1 < argc)
+			profile_path = argv[++i];
+		else if (arg == "--mute")
+			mute = true;
+		else if (arg == "--assets" && i + 1 < argc)
+			assets_path = argv[++i];
+		else if (arg == "--pacing" && i + 1 < argc)
+		{
+			if (!pacing_parse(argv[++i], &pacing_mode, &pacing_cap))
+				fprintf(stderr, "Unknown pacing %s, using adaptive\n", argv[i]);
+		}
+		else if (arg == "--audio-wav" && i + 1 < argc)
+			audio_path = argv[++i];
+	}
 
 	glfwSetErrorCallback(error_callback);
 
@@ -346,6 +762,7 @@ int main(int argc, char* argv[])
 
 	//Hide Mouse Cursor, Still allows mouse to exit window
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+	input_queue_init(&input_queue);
 	glfwSetKeyCallback(window, key_callback);
 	glfwSetWindowSizeCallback(window, window_size_callback);
 
@@ -369,8 +786,10 @@ int main(int argc, char* argv[])
 	printf("Renderer used: %s\n", glGetString(GL_RENDERER));
 	printf("Shading Language: %s\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
-	//change to 1 to enable vsync
-	glfwSwapInterval(0);
+	// 'f' cycles through the pacing modes
+	Pacer pacer;
+	pacer_init(&pacer, pacing_mode, pacing_cap, glfwGetVideoMode(glfwGetPrimaryMonitor())->refreshRate);
+	glfwSwapInterval(pacer_swap_interval(&pacer));
 
 	glClearColor(1.0, 0.0, 0.0, 1.0);
 
@@ -382,15 +801,13 @@ int main(int argc, char* argv[])
 
 	buffer_clear(&buffer, 0);
 
+	Renderer* renderer = new Renderer;
+	renderer_init(renderer, &buffer);
+
 	// Create texture for presenting buffer to OpenGL
-	GLuint buffer_texture;
-	glGenTextures(1, &buffer_texture);
-	glBindTexture(GL_TEXTURE_2D, buffer_texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, buffer.width, buffer.height, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, buffer.data);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	TextureUpload upload;
+	upload_init(&upload, buffer);
+	printf("Texture upload: %s\n", upload.pbo ? "persistent mapped buffer ring" : "direct");
 
 
 	// Create vao for generating fullscreen triangle
@@ -458,6 +875,8 @@ int main(int argc, char* argv[])
 		fprintf(stderr, "Error while validating shader.\n");
 		glfwTerminate();
 		glDeleteVertexArrays(1, &fullscreen_triangle_vao);
+		renderer_free(renderer);
+		delete renderer;
 		delete[] buffer.data;
 		return -1;
 	}
@@ -474,774 +893,323 @@ int main(int argc, char* argv[])
 
 	glBindVertexArray(fullscreen_triangle_vao);
 
-	// Prepare game
-	Sprite alien_sprites[6];
-
-	alien_sprites[0].width = 8;
-	alien_sprites[0].height = 8;
-	alien_sprites[0].color = rgb_to_uint32(255, 154, 0);
-	alien_sprites[0].data = new uint8_t[64]
-	{
-		0,0,0,1,1,0,0,0, // ...@@...
-		0,0,1,1,1,1,0,0, // ..@@@@..
-		0,1,1,1,1,1,1,0, // .@@@@@@.
-		1,1,0,1,1,0,1,1, // @@.@@.@@
-		1,1,1,1,1,1,1,1, // @@@@@@@@
-		0,1,0,1,1,0,1,0, // .@.@@.@.
-		1,0,0,0,0,0,0,1, // @......@
-		0,1,0,0,0,0,1,0  // .@....@.
-	};
-
-	alien_sprites[1].width = 8;
-	alien_sprites[1].height = 8;
-	alien_sprites[1].color = rgb_to_uint32(255, 154, 0);
-	alien_sprites[1].data = new uint8_t[64]
-	{
-		0,0,0,1,1,0,0,0, // ...@@...
-		0,0,1,1,1,1,0,0, // ..@@@@..
-		0,1,1,1,1,1,1,0, // .@@@@@@.
-		1,1,0,1,1,0,1,1, // @@.@@.@@
-		1,1,1,1,1,1,1,1, // @@@@@@@@
-		0,0,1,0,0,1,0,0, // ..@..@..
-		0,1,0,1,1,0,1,0, // .@.@@.@.
-		1,0,1,0,0,1,0,1  // @.@..@.@
-	};
-
-	alien_sprites[2].width = 11;
-	alien_sprites[2].height = 8;
-	alien_sprites[2].color = rgb_to_uint32(0, 120, 255);
-	alien_sprites[2].data = new uint8_t[88]
-	{
-		0,0,1,0,0,0,0,0,1,0,0, // ..@.....@..
-		0,0,0,1,0,0,0,1,0,0,0, // ...@...@...
-		0,0,1,1,1,1,1,1,1,0,0, // ..@@@@@@@..
-		0,1,1,0,1,1,1,0,1,1,0, // .@@.@@@.@@.
-		1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@
-		1,0,1,1,1,1,1,1,1,0,1, // @.@@@@@@@.@
-		1,0,1,0,0,0,0,0,1,0,1, // @.@.....@.@
-		0,0,0,1,1,0,1,1,0,0,0  // ...@@.@@...
-	};
-
-	alien_sprites[3].width = 11;
-	alien_sprites[3].height = 8;
-	alien_sprites[3].color = rgb_to_uint32(0, 120, 255);
-	alien_sprites[3].data = new uint8_t[88]
-	{
-		0,0,1,0,0,0,0,0,1,0,0, // ..@.....@..
-		1,0,0,1,0,0,0,1,0,0,1, // @..@...@..@
-		1,0,1,1,1,1,1,1,1,0,1, // @.@@@@@@@.@
-		1,1,1,0,1,1,1,0,1,1,1, // @@@.@@@.@@@
-		1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@
-		0,1,1,1,1,1,1,1,1,1,0, // .@@@@@@@@@.
-		0,0,1,0,0,0,0,0,1,0,0, // ..@.....@..
-		0,1,0,0,0,0,0,0,0,1,0  // .@.......@.
-	};
-
-	alien_sprites[4].width = 12;
-	alien_sprites[4].height = 8;
-	alien_sprites[4].color = rgb_to_uint32(189, 0, 255);
-	alien_sprites[4].data = new uint8_t[96]
-	{
-		0,0,0,0,1,1,1,1,0,0,0,0, // ....@@@@....
-		0,1,1,1,1,1,1,1,1,1,1,0, // .@@@@@@@@@@.
-		1,1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@@
-		1,1,1,0,0,1,1,0,0,1,1,1, // @@@..@@..@@@
-		1,1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@@
-		0,0,0,1,1,0,0,1,1,0,0,0, // ...@@..@@...
-		0,0,1,1,0,1,1,0,1,1,0,0, // ..@@.@@.@@..
-		1,1,0,0,0,0,0,0,0,0,1,1  // @@........@@
-	};
-
-
-	alien_sprites[5].width = 12;
-	alien_sprites[5].height = 8;
-	alien_sprites[5].color = rgb_to_uint32(189, 0, 255);
-	alien_sprites[5].data = new uint8_t[96]
-	{
-		0,0,0,0,1,1,1,1,0,0,0,0, // ....@@@@....
-		0,1,1,1,1,1,1,1,1,1,1,0, // .@@@@@@@@@@.
-		1,1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@@
-		1,1,1,0,0,1,1,0,0,1,1,1, // @@@..@@..@@@
-		1,1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@@
-		0,0,1,1,1,0,0,1,1,1,0,0, // ..@@@..@@@..
-		0,1,1,0,0,1,1,0,0,1,1,0, // .@@..@@..@@.
-		0,0,1,1,0,0,0,0,1,1,0,0  // ..@@....@@..
-	};
-
-	Sprite alien_death_sprite;
-	alien_death_sprite.width = 13;
-	alien_death_sprite.height = 7;
-	alien_death_sprite.color = rgb_to_uint32(255, 0, 0);
-	alien_death_sprite.data = new uint8_t[91]
-	{
-		0,1,0,0,1,0,0,0,1,0,0,1,0, // .@..@...@..@.
-		0,0,1,0,0,1,0,1,0,0,1,0,0, // ..@..@.@..@..
-		0,0,0,1,0,0,0,0,0,1,0,0,0, // ...@.....@...
-		1,1,0,0,0,0,0,0,0,0,0,1,1, // @@.........@@
-		0,0,0,1,0,0,0,0,0,1,0,0,0, // ...@.....@...
-		0,0,1,0,0,1,0,1,0,0,1,0,0, // ..@..@.@..@..
-		0,1,0,0,1,0,0,0,1,0,0,1,0  // .@..@...@..@.
-	};
-
-	Sprite player_sprite;
-	player_sprite.width = 11;
-	player_sprite.height = 7;
-	player_sprite.data = new uint8_t[77]
-	{
-		0,0,0,0,0,1,0,0,0,0,0, // .....@.....
-		0,0,0,0,1,1,1,0,0,0,0, // ....@@@....
-		0,0,0,0,1,1,1,0,0,0,0, // ....@@@....
-		0,1,1,1,1,1,1,1,1,1,0, // .@@@@@@@@@.
-		1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@
-		1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@
-		1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@
-	};
-
+	if (!bundle_open(&assets, assets_path.c_str()))
+		printf("No asset bundle at %s, loading audio/*.wav\n", assets_path.c_str());
+	if (audio_path)
+		open_audio(audio_backend_offline, audio_path);
+	else
+		open_audio(mute ? audio_backend_null : audio_backend_irrklang, NULL);
+#endif
 
-	Sprite text_spritesheet;
-	text_spritesheet.width = 5;
-	text_spritesheet.height = 7;
-	text_spritesheet.data = new uint8_t[65 * 35]
+	// Prepare game. Headless runs start from a high score of 0 and leave
+	// the leaderboard alone, so they do not depend on the directory.
+	Game game;
+	uint32_t seed = 13;
+	uint32_t start_high_score = 0;
+#ifndef HEADLESS
+	leaderboard = new Leaderboard;
+	leaderboard_load(leaderboard, leaderboard_path);
+	start_high_score = leaderboard_high_score(leaderboard);
+
+	// A replay starts from the same state it was recorded from
+	ReplayReader* replay = NULL;
+	if (replay_path)
 	{
-		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // ' '
-		0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,0,0,0,0,0,1,0,0, // '!'
-		0,1,0,1,0,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // '"'
-		0,1,0,1,0,0,1,0,1,0,1,1,1,1,1,0,1,0,1,0,1,1,1,1,1,0,1,0,1,0,0,1,0,1,0, // '#'
-		0,0,1,0,0,0,1,1,1,0,1,0,1,0,0,0,1,1,1,0,0,0,1,0,1,0,1,1,1,0,0,0,1,0,0, // '$'
-		1,1,0,1,0,1,1,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,0,1,1,0,1,0,1,1, // '%'
-		0,1,1,0,0,1,0,0,1,0,1,0,0,1,0,0,1,1,0,0,1,0,0,1,0,1,0,0,0,1,0,1,1,1,1, // '&'
-		0,0,0,1,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // '`'
-		0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,1, // '{'
-		1,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0, // '}'
-		0,0,1,0,0,1,0,1,0,1,0,1,1,1,0,0,0,1,0,0,0,1,1,1,0,1,0,1,0,1,0,0,1,0,0, // '*'
-		0,0,0,0,0,0,0,1,0,0,0,0,1,0,0,1,1,1,1,1,0,0,1,0,0,0,0,1,0,0,0,0,0,0,0, // '+'
-		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,1,0,0, // ','
-		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // '-'
-		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0, // '.'
-		0,0,0,1,0,0,0,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,0,0,0,0,1,0,0,0, // '/'
-
-		0,1,1,1,0,1,0,0,0,1,1,0,0,1,1,1,0,1,0,1,1,1,0,0,1,1,0,0,0,1,0,1,1,1,0, // '0'
-		0,0,1,0,0,0,1,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,1,1,0, // '1'
-		0,1,1,1,0,1,0,0,0,1,0,0,0,0,1,0,0,1,1,0,0,1,0,0,0,1,0,0,0,0,1,1,1,1,1, // '2'
-		1,1,1,1,1,0,0,0,0,1,0,0,0,1,0,0,0,1,1,0,0,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // '3'
-		0,0,0,1,0,0,0,1,1,0,0,1,0,1,0,1,0,0,1,0,1,1,1,1,1,0,0,0,1,0,0,0,0,1,0, // '4'
-		1,1,1,1,1,1,0,0,0,0,1,1,1,1,0,0,0,0,0,1,0,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // '5'
-		0,1,1,1,0,1,0,0,0,1,1,0,0,0,0,1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // '6'
-		1,1,1,1,1,0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0, // '7'
-		0,1,1,1,0,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // '8'
-		0,1,1,1,0,1,0,0,0,1,1,0,0,0,1,0,1,1,1,1,0,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // '9'
-
-		0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0, // ':'
-		0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,1,0,0, // ';'
-		0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,1, // '<'
-		0,0,0,0,0,0,0,0,0,0,1,1,1,1,1,0,0,0,0,0,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0, // '='
-		1,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0, // '>'
-		0,1,1,1,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,0,0,0,0,0,1,0,0, // '?'
-		0,1,1,1,0,1,0,0,0,1,1,0,1,0,1,1,1,0,1,1,1,0,1,0,0,1,0,0,0,1,0,1,1,1,0, // '@'
-
-		0,0,1,0,0,0,1,0,1,0,1,0,0,0,1,1,0,0,0,1,1,1,1,1,1,1,0,0,0,1,1,0,0,0,1, // 'A'
-		1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,1,1,1,0, // 'B'
-		0,1,1,1,0,1,0,0,0,1,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,0,1,1,1,0, // 'C'
-		1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,1,1,1,0, // 'D'
-		1,1,1,1,1,1,0,0,0,0,1,0,0,0,0,1,1,1,1,0,1,0,0,0,0,1,0,0,0,0,1,1,1,1,1, // 'E'
-		1,1,1,1,1,1,0,0,0,0,1,0,0,0,0,1,1,1,1,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0, // 'F'
-		0,1,1,1,0,1,0,0,0,1,1,0,0,0,0,1,0,1,1,1,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // 'G'
-		1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,1,1,1,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1, // 'H'
-		0,1,1,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,1,1,0, // 'I'
-		0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // 'J'
-		1,0,0,0,1,1,0,0,1,0,1,0,1,0,0,1,1,0,0,0,1,0,1,0,0,1,0,0,1,0,1,0,0,0,1, // 'K'
-		1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,1,1,1,1, // 'L'
-		1,0,0,0,1,1,1,0,1,1,1,0,1,0,1,1,0,1,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1, // 'M'
-		1,0,0,0,1,1,0,0,0,1,1,1,0,0,1,1,0,1,0,1,1,0,0,1,1,1,0,0,0,1,1,0,0,0,1, // 'N'
-		0,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // 'O'
-		1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,1,1,1,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0, // 'P'
-		0,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,1,0,1,1,0,0,1,1,0,1,1,1,1, // 'Q'
-		1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,1,1,1,0,1,0,1,0,0,1,0,0,1,0,1,0,0,0,1, // 'R'
-		0,1,1,1,0,1,0,0,0,1,1,0,0,0,0,0,1,1,1,0,0,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // 'S'
-		1,1,1,1,1,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0, // 'T'
-		1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // 'U'
-		1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,0,1,0,1,0,0,0,1,0,0, // 'V'
-		1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,1,0,1,1,0,1,0,1,1,1,0,1,1,1,0,0,0,1, // 'W'
-		1,0,0,0,1,1,0,0,0,1,0,1,0,1,0,0,0,1,0,0,0,1,0,1,0,1,0,0,0,1,1,0,0,0,1, // 'X'
-		1,0,0,0,1,1,0,0,0,1,0,1,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0, // 'Y'
-		1,1,1,1,1,0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,1,1,1,1,1, // 'Z'
-
-		0,0,0,1,1,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,0,1,1, // ']'
-		0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0, // '\'
-		1,1,0,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,1,1,0,0,0, // ']'
-		0,0,1,0,0,0,1,0,1,0,1,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // '^'
-		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,1, // '_'
-		0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0  // '''
-	};
-
-	Sprite number_spritesheet = text_spritesheet;
-	number_spritesheet.data += 16 * 35;
+		replay = new ReplayReader;
+		bool ok = replay_open_read(replay, replay_path);
+		if (ok && (replay->header.width != buffer_width || replay->header.height != buffer_height))
+		{
+			fprintf(stderr, "Error: %s was recorded at %ux%u, not %zux%zu\n", replay_path,
+				replay->header.width, replay->header.height, buffer_width, buffer_height);
+			replay_close_read(replay);
+			ok = false;
+		}
+		if (ok)
+		{
+			seed = replay->header.seed;
+			start_high_score = replay->header.high_score;
+		}
+		else
+		{
+			delete replay;
+			replay = NULL;
+		}
+	}
+#endif
+	game_init(game, buffer_width, buffer_height, seed, start_high_score);
 
-	Sprite player_bullet_sprite;
-	player_bullet_sprite.width = 1;
-	player_bullet_sprite.height = 3;
-	player_bullet_sprite.data = new uint8_t[3]
+	ReplayWriter* recording = NULL;
+	if (record_path)
 	{
-		1, 1, 1
-	};
+		recording = new ReplayWriter;
+		if (!replay_open_write(recording, record_path, buffer_width, buffer_height, seed, start_high_score))
+		{
+			delete recording;
+			recording = NULL;
+		}
+	}
 
-	Sprite alien_bullet_sprite[2];
-	alien_bullet_sprite[0].width = 3;
-	alien_bullet_sprite[0].height = 7;
-	alien_bullet_sprite[0].data = new uint8_t[21]
-	{
-		0,1,0,1,0,0,0,1,0,0,0,1,0,1,0,1,0,0,0,1,0,
-	};
+	game_running = true;
 
-	alien_bullet_sprite[1].width = 3;
-	alien_bullet_sprite[1].height = 7;
-	alien_bullet_sprite[1].data = new uint8_t[21]
+#ifdef HEADLESS
+	size_t move_audio_i = 0;
+	Input input = Input();
+	uint32_t input_rng = 7;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point timer = start;
+	size_t updates = 0, total_updates = 0;
+
+	Profiler* main_profiler = NULL;
+	if (profile_path)
 	{
-		0,1,0,0,0,1,0,1,0,1,0,0,0,1,0,0,0,1,0,1,0,
-	};
-
-
-	SpriteAnimation alien_bullet_animation;
-	alien_bullet_animation.loop = true;
-	alien_bullet_animation.num_frames = 2;
-	alien_bullet_animation.frame_duration = 5;
-	alien_bullet_animation.time = 0;
-
-	alien_bullet_animation.frames = new Sprite * [2];
-	alien_bullet_animation.frames[0] = &alien_bullet_sprite[0];
-	alien_bullet_animation.frames[1] = &alien_bullet_sprite[1];
+		main_profiler = new Profiler;
+		profile_reset(main_profiler);
+		profiler = main_profiler;
+	}
 
-	SpriteAnimation alien_animation[3];
+	// - No wall-clock throttle, step as fast as possible
+	while (game_running && total_updates < max_ticks) {
+		headless_input(&input_rng, game.player.life == 0, input);
+		game_step(game, input);
+		if (recording)
+			replay_write_tick(recording, input);
+		play_event_sounds(game, &move_audio_i);
+		audio_advance(audio);
+
+		if (render)
+			game_draw(renderer, game);
+		if (dump && total_updates % dump_every == 0)
+			frame_dump_write(dump, buffer);
+		if (profiler)
+			profile_commit(profiler);
+
+		updates++;
+		total_updates++;
+
+		// - Report ticks per second
+		if ((total_updates & 4095) == 0)
+		{
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (std::chrono::duration<double>(now - timer).count() > 1.0)
+			{
+				std::cout << "TPS: " << updates << " Level: " << game.level << " Score: " << game.score << std::endl;
+				timer = now;
+				updates = 0;
+			}
+		}
+	}
 
-	size_t alien_update_frequency = 120;
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("Ticks: %zu in %.3f s (%.0f ticks/s)\n", total_updates, elapsed, total_updates / elapsed);
+	printf("Level: %zu Score: %zu High Score: %u\n", game.level, game.score, game.high_score);
 
-	for (size_t i = 0; i < 3; ++i)
+	if (dump)
 	{
-		alien_animation[i].loop = true;
-		alien_animation[i].num_frames = 2;
-		alien_animation[i].frame_duration = alien_update_frequency;
-		alien_animation[i].time = 0;
-
-		alien_animation[i].frames = new Sprite * [2];
-		alien_animation[i].frames[0] = &alien_sprites[2 * i];
-		alien_animation[i].frames[1] = &alien_sprites[2 * i + 1];
+		// Includes waiting for the writer to catch up
+		frame_dump_close(dump);
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("Frames: %llu written to %s (%.0f frames/s)\n", (unsigned long long)dump->frames_written,
+			dump_path, dump->frames_written / elapsed);
+		delete dump;
 	}
 
-	Game game;
-	game.width = buffer_width;
-	game.height = buffer_height;
-	game.num_bullets = 0;
-	game.num_aliens = 55;
-	game.aliens = new Alien[game.num_aliens];
-
-	game.player.x = 112 - 5;
-	game.player.y = 32;
-
-	game.player.life = 3;
-	std::string move_audio[4] = {
-		"audio/move1.wav",
-		"audio/move2.wav",
-		"audio/move3.wav",
-		"audio/move4.wav"
-	};
-	size_t move_audio_i = 0;
-
-	size_t alien_swarm_position = 24;
-	size_t alien_swarm_max_position = game.width - 16 * 11 - 3;
-
-	size_t aliens_killed = 0;
-	size_t alien_update_timer = 0;
-	bool should_change_speed = false;
-
-	for (size_t xi = 0; xi < 11; ++xi)
+	if (main_profiler)
 	{
-		for (size_t yi = 0; yi < 5; ++yi)
+		ProfileSummary summary;
+		profile_summarize(main_profiler, &summary);
+		for (size_t s = 0; s < PROFILE_STAGE_COUNT; ++s)
 		{
-			Alien& alien = game.aliens[xi * 5 + yi];
-			alien.type = (5 - int(yi)) / 2 + 1;
-			const Sprite& sprite = alien_sprites[2 * (alien.type - 1)];
-
-			alien.x = 16 * xi + alien_swarm_position + (alien_death_sprite.width - sprite.width) / 2;
-			alien.y = 17 * yi + 128;
+			if (summary.count[s] == 0) continue;
+			printf("%-11s min %8.3f avg %8.3f p99 %8.3f us\n", profile_stage_names[s],
+				summary.min_us[s], summary.avg_us[s], summary.p99_us[s]);
 		}
+		profile_write_csv(profile_path, &main_profiler, 1);
+		profiler = NULL;
+		delete main_profiler;
 	}
-
-	uint8_t* death_counters = new uint8_t[game.num_aliens];
-	for (size_t i = 0; i < game.num_aliens; ++i)
-	{
-		death_counters[i] = 10;
-	}
-
-	const uint32_t alien_color = rgb_to_uint32(255, 255, 255); // White
-	const uint32_t player_color = rgb_to_uint32(0, 255, 0); // Green
-	const uint32_t red_color = rgb_to_uint32(255, 0, 0); // Red
-	const uint32_t clear_color = rgb_to_uint32(0, 0, 30); // Navy BLue
-
-	uint32_t rng = 13;
-
-	int alien_move_dir = 4;
-
-	High_Score high_score;
-	read_high_score(high_score);
-	size_t score = 0;
-	size_t level = 1;
-
-	game_running = true;
-
-	int player_move_dir = 0;
-	static double limitFPS = 1.0 / 60.0;
-
-	double lastTime = glfwGetTime(), timer = lastTime;
-	double deltaTime = 0, nowTime = 0;
+	close_audio();
+	bundle_close(&assets);
+#else
+	// - The simulation runs at 60 ticks/s on its own thread and hands
+	//   every tick to this one through a triple buffer
+	SnapshotHandoff* handoff = new SnapshotHandoff;
+	handoff_init(handoff);
+	Profiler* sim_profiler = new Profiler;
+	Profiler* render_profiler = new Profiler;
+	profile_reset(sim_profiler);
+	profile_reset(render_profiler);
+	profiler = render_profiler;
+	ProfileSummary overlay_summary = ProfileSummary();
+
+	// Only finished games are written, a crash loses at most the one in play
+	LeaderboardEntry best[LEADERBOARD_SIZE];
+	size_t num_best = leaderboard_top(leaderboard, best, LEADERBOARD_SIZE);
+	for (size_t i = 0; i < num_best; ++i)
+		printf("%2zu. %6u  level %u\n", i + 1, best[i].score, best[i].level);
+	if (!replay)
+		leaderboard_start(leaderboard);
+
+	SimulationIO io = { recording, replay, replay_speed ? replay_speed : 1, sim_profiler,
+		replay ? NULL : leaderboard };
+	std::thread simulation(simulation_thread, &game, handoff, &io);
+
+	const GameSnapshot* snapshot = NULL;
+	Game prev_game, draw_game, last_game;
+	uint64_t last_tick = 0;
+	double limitFPS = 1.0 / 60.0;
+	double timer = glfwGetTime();
 	size_t frames = 0, updates = 0;
 
+	// Input to photon latency: from a key event to the return of the
+	// first swap showing the tick that applied it. Scan-out after the
+	// swap is not included.
+	uint64_t input_serial = 0;
+	double latency_sum = 0, latency_max = 0;
+	size_t latency_count = 0;
 
 	// - While window is alive
-	while (!glfwWindowShouldClose(window) && game_running) {
-
-		// - Measure time
-		nowTime = glfwGetTime();
-		deltaTime += (nowTime - lastTime) / limitFPS;
-		lastTime = nowTime;
-
-		// - Only update at 60 frames / s
-		while (deltaTime >= 1.0) {
-			updates++;
-			deltaTime--;
-
-			if (window_resize)
-			{
-				GLsizei my_ratio = screen_height / buffer_height;
-				GLsizei my_width = buffer_width * my_ratio;
-				GLsizei black_bar = (screen_width - my_width) / 2;
-				glViewport(black_bar, 0, my_width, screen_height);
-				window_resize = false;
-			}
-			buffer_clear(&buffer, clear_color);
-
-			const int text_border_offset = 10;
-			const int score_txt_width = std::string("SCORE").length() * (text_spritesheet.width + 1);
-			int score_txt_pos = text_border_offset;
-			int score_width = std::to_string(score).length() * (number_spritesheet.width + 1);
-			int score_pos = score_txt_pos + (score_txt_width / 2 - score_width / 2);
-			buffer_draw_text(&buffer, text_spritesheet, "SCORE", score_txt_pos, game.height - text_spritesheet.height - 7, red_color);
-			buffer_draw_number(&buffer, number_spritesheet, score, score_pos, game.height - 2 * number_spritesheet.height - 12, red_color);
-
-			//Draw High_Score - there is a 1px space between each character
-			const int high_score_txt_width = std::string("HIGH SCORE").length() * (text_spritesheet.width + 1);
-			int high_score_txt_pos = game.width - text_border_offset - high_score_txt_width;
-			int high_score_width = std::to_string(high_score.hs).length() * (number_spritesheet.width + 1);
-			int high_score_pos = (game.width - high_score_width) - (high_score_txt_width / 2 - high_score_width / 2) - text_border_offset;
-			buffer_draw_text(&buffer, text_spritesheet, "HIGH SCORE", high_score_txt_pos, game.height - text_spritesheet.height - 7, red_color);
-			buffer_draw_number(&buffer, number_spritesheet, high_score.hs, high_score_pos, game.height - 2 * number_spritesheet.height - 12, red_color);
-
-			std::string level_text = "LEVEL " + std::to_string(level);
-			int level_text_width = level_text.length() * (number_spritesheet.width + 1);
-			int level_text_pos = (game.width - level_text_width) - text_border_offset;
-			buffer_draw_text(&buffer, text_spritesheet, level_text.c_str() , level_text_pos, text_spritesheet.height, red_color);
-
-
-			if (game_over)
-				game.player.life = 0;
-
-			if (game.player.life == 0)
-			{
-				game_over = false;
-
-				buffer_draw_text(&buffer, text_spritesheet, "GAME OVER", game.width / 2 - 30, game.height / 2, red_color);
-				glTexSubImage2D(
-					GL_TEXTURE_2D, 0, 0, 0,
-					buffer.width, buffer.height,
-					GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,
-					buffer.data
-				);
-				glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-				glfwSwapBuffers(window);
-				glfwPollEvents();
-				if (reset)
-					//Exit this IF Statement... will be change properly further down.
-					game.player.life = 1;
-				continue;
-			}
-
-			buffer_draw_number(&buffer, number_spritesheet, game.player.life, 4, 7, red_color);
-			size_t xp = 11 + number_spritesheet.width;
-			for (size_t i = 0; i < game.player.life - 1; ++i)
-			{
-				//Lives Sprite
-				buffer_draw_sprite(&buffer, player_sprite, xp, 7, player_color);
-				xp += player_sprite.width + 2;
-			}
-
-			//Line on Bottom
-			for (size_t i = 0; i < game.width; ++i)
-			{
-				buffer.data[game.width * 16 + i] = player_color;
-			}
-
-
-			for (size_t ai = 0; ai < game.num_aliens; ++ai)
-			{
-				if (death_counters[ai] == 0) continue;
-
-				const Alien& alien = game.aliens[ai];
-				if (alien.type == ALIEN_DEAD)
-				{
-					buffer_draw_sprite(&buffer, alien_death_sprite, alien.x, alien.y);
-				}
-				else
-				{
-					const SpriteAnimation& animation = alien_animation[alien.type - 1];
-					size_t current_frame = animation.time / animation.frame_duration;
-					const Sprite& sprite = *animation.frames[current_frame];
-					buffer_draw_sprite(&buffer, sprite, alien.x, alien.y);
-				}
-			}
-
-			for (size_t bi = 0; bi < game.num_bullets; ++bi)
-			{
-				const Bullet& bullet = game.bullets[bi];
-				const Sprite* sprite;
-				if (bullet.dir > 0)
-					sprite = &player_bullet_sprite;
-				else
-				{
-					size_t cf = alien_bullet_animation.time / alien_bullet_animation.frame_duration;
-					sprite = &alien_bullet_sprite[cf];
-				}
-
-				//if player bullet
-				if (bullet.dir > 0)
-					buffer_draw_sprite(&buffer, *sprite, bullet.x, bullet.y, player_color);
-				else
-					buffer_draw_sprite(&buffer, *sprite, bullet.x, bullet.y, alien_color);
-			}
-			buffer_draw_sprite(&buffer, player_sprite, game.player.x, game.player.y, player_color);
-
-			// Simulate bullets
-			for (size_t bi = 0; bi < game.num_bullets; ++bi)
-			{
-				game.bullets[bi].y += game.bullets[bi].dir;
-				if (game.bullets[bi].y >= game.height || game.bullets[bi].y < player_bullet_sprite.height)
-				{
-					game.bullets[bi] = game.bullets[game.num_bullets - 1];
-					--game.num_bullets;
-					continue;
-				}
-
-				// Alien bullet
-				if (game.bullets[bi].dir < 0)
-				{
-					bool overlap = sprite_overlap_check(
-						alien_bullet_sprite[0], game.bullets[bi].x, game.bullets[bi].y,
-						player_sprite, game.player.x, game.player.y
-					);
-
-					if (overlap)
-					{
-						SoundEngine->play2D("audio/explosion.wav", false);
-						--game.player.life;
-						game.bullets[bi] = game.bullets[game.num_bullets - 1];
-						--game.num_bullets;
-						//NOTE: The rest of the frame is still going to be simulated.
-						//perhaps we need to check if the game is over or not.
-						break;
-					}
-				}
-				// Player bullet
-				else
-				{
-					// Check if player bullet hits an alien bullet
-					for (size_t bj = 0; bj < game.num_bullets; ++bj)
-					{
-						if (bi == bj) continue;
-
-						bool overlap = sprite_overlap_check(
-							player_bullet_sprite, game.bullets[bi].x, game.bullets[bi].y,
-							alien_bullet_sprite[0], game.bullets[bj].x, game.bullets[bj].y
-						);
-
-						if (overlap)
-						{
-							// NOTE: Make sure it works.
-							if (bj == game.num_bullets - 1)
-							{
-								game.bullets[bi] = game.bullets[game.num_bullets - 2];
-							}
-							else if (bi == game.num_bullets - 1)
-							{
-								game.bullets[bj] = game.bullets[game.num_bullets - 2];
-							}
-							else
-							{
-								game.bullets[(bi < bj) ? bi : bj] = game.bullets[game.num_bullets - 1];
-								game.bullets[(bi < bj) ? bj : bi] = game.bullets[game.num_bullets - 2];
-							}
-							game.num_bullets -= 2;
-							break;
-						}
-					}
-
-					// Check hit
-					for (size_t ai = 0; ai < game.num_aliens; ++ai)
-					{
-						const Alien& alien = game.aliens[ai];
-						if (alien.type == ALIEN_DEAD) continue;
-
-						const SpriteAnimation& animation = alien_animation[alien.type - 1];
-						size_t current_frame = animation.time / animation.frame_duration;
-						const Sprite& alien_sprite = *animation.frames[current_frame];
-						bool overlap = sprite_overlap_check(
-							player_bullet_sprite, game.bullets[bi].x, game.bullets[bi].y,
-							alien_sprite, alien.x, alien.y
-						);
-
-						if (overlap)
-						{
-							//if top row
-							if (game.aliens[ai].type == 1)
-								score += 40;
-							else
-								score += 10 * (4 - game.aliens[ai].type);
-							game.aliens[ai].type = ALIEN_DEAD;
-							// NOTE: Hack to recenter death sprite
-							game.aliens[ai].x -= (alien_death_sprite.width - alien_sprite.width) / 2;
-							game.bullets[bi] = game.bullets[game.num_bullets - 1];
-							--game.num_bullets;
-							++aliens_killed;
-							SoundEngine->play2D("audio/invader_killed.wav", false);
-
-							if (aliens_killed % 15 == 0) should_change_speed = true;
-
-							break;
-						}
-					}
-				}
-			}
-
-			// Simulate aliens
-			if (should_change_speed)
-			{
-				should_change_speed = false;
-				alien_update_frequency /= 2;
-				for (size_t i = 0; i < 3; ++i)
-				{
-					alien_animation[i].frame_duration = alien_update_frequency;
-				}
-			}
-
-			// Update death counters
-			for (size_t ai = 0; ai < game.num_aliens; ++ai)
-			{
-				const Alien& alien = game.aliens[ai];
-				if (alien.type == ALIEN_DEAD && death_counters[ai])
-				{
-					--death_counters[ai];
-				}
-			}
-
-			if (alien_update_timer >= alien_update_frequency)
-			{
-				SoundEngine->play2D(move_audio[move_audio_i].c_str(), false);
-				move_audio_i++;
-				if (move_audio_i == 4)
-					move_audio_i = 0;
-				alien_update_timer = 0;
-
-				if ((int)alien_swarm_position + alien_move_dir < 0)
-				{
-					alien_move_dir *= -1;
-					//TODO: Perhaps if aliens get close enough to player, we need to check
-					//for overlap. What happens when alien moves over line y = 0 line?
-					for (size_t ai = 0; ai < game.num_aliens; ++ai)
-					{
-						Alien& alien = game.aliens[ai];
-						alien.y -= 8;
-					}
-				}
-				else if (alien_swarm_position > alien_swarm_max_position - alien_move_dir)
-				{
-					alien_move_dir *= -1;
-				}
-				alien_swarm_position += alien_move_dir;
-
-				for (size_t ai = 0; ai < game.num_aliens; ++ai)
-				{
-					Alien& alien = game.aliens[ai];
-					alien.x += alien_move_dir;
-				}
-
-				if (aliens_killed < game.num_aliens)
-				{
-					size_t rai = game.num_aliens * random(&rng);
-					while (game.aliens[rai].type == ALIEN_DEAD)
-					{
-						rai = game.num_aliens * random(&rng);
-					}
-					if (game.num_bullets < GAME_MAX_BULLETS) {
-						const Sprite& alien_sprite = *alien_animation[game.aliens[rai].type - 1].frames[0];
-						game.bullets[game.num_bullets].x = game.aliens[rai].x + alien_sprite.width / 2;
-						game.bullets[game.num_bullets].y = game.aliens[rai].y - alien_bullet_sprite[0].height;
-						game.bullets[game.num_bullets].dir = -2;
-						++game.num_bullets;
-					}
-				}
-			}
-
-			// Update animations
-			for (size_t i = 0; i < 3; ++i)
-			{
-				++alien_animation[i].time;
-				if (alien_animation[i].time >= alien_animation[i].num_frames * alien_animation[i].frame_duration)
-				{
-					alien_animation[i].time = 0;
-				}
-			}
-			++alien_bullet_animation.time;
-			if (alien_bullet_animation.time >= alien_bullet_animation.num_frames * alien_bullet_animation.frame_duration)
-			{
-				alien_bullet_animation.time = 0;
-			}
+	while (game_running) {
+		if (glfwWindowShouldClose(window)) break;
 
-			++alien_update_timer;
-
-			// Simulate player
-			player_move_dir = 2 * move_dir;
-
-			if (player_move_dir != 0)
-			{
-				if (game.player.x + player_sprite.width + player_move_dir >= game.width)
-				{
-					game.player.x = game.width - player_sprite.width;
-				}
-				else if ((int)game.player.x + player_move_dir <= 0)
-				{
-					game.player.x = 0;
-				}
-				else game.player.x += player_move_dir;
-			}
-
-			if (aliens_killed < game.num_aliens && !reset)
-			{
-				if (score > high_score.hs)
-					high_score.hs = score;
-				size_t ai = 0;
-				while (game.aliens[ai].type == ALIEN_DEAD) ++ai;
-				const Sprite& sprite = alien_sprites[2 * (game.aliens[ai].type - 1)];
-				size_t pos = game.aliens[ai].x - (alien_death_sprite.width - sprite.width) / 2;
-				if (pos > alien_swarm_position) alien_swarm_position = pos;
-
-				ai = game.num_aliens - 1;
-				while (game.aliens[ai].type == ALIEN_DEAD) --ai;
-				pos = game.width - game.aliens[ai].x - 13 + pos;
-				if (pos > alien_swarm_max_position) alien_swarm_max_position = pos;
-				ASSERT(alien_swarm_max_position <= buffer_width);
-			}
-			else
-			{
-				if (reset)
-				{
-					reset = false;
-					game.player.life = 3;
-					score = 0;
-					fire_pressed = false;
-					level = 0;
-				}
-				should_change_speed = true;
-				level++;
-				game.num_bullets = 0;
-				alien_swarm_max_position = game.width - 16 * 11 - 3; //Reset max alien width
-				if (level <= 8)
-					alien_update_frequency = 120 - (level * 10);
-				else if (level <= 36) // 120-80-36 = 4 since each level doubles in speed twice, this is maximum speed.
-					alien_update_frequency = 120 - 8 * 10 - level;
-				else
-					alien_update_frequency = 4;
-
-				alien_swarm_position = 24;
-
-				aliens_killed = 0;
-				alien_update_timer = 0;
-
-				alien_move_dir = 4;
-
-				for (size_t xi = 0; xi < 11; ++xi)
-				{
-					for (size_t yi = 0; yi < 5; ++yi)
-					{
-						size_t ai = xi * 5 + yi;
-
-						death_counters[ai] = 10;
-
-						Alien& alien = game.aliens[ai];
-						alien.type = (5 - yi) / 2 + 1;
+		if (window_resize)
+		{
+			GLsizei my_ratio = screen_height / buffer_height;
+			GLsizei my_width = buffer_width * my_ratio;
+			GLsizei black_bar = (screen_width - my_width) / 2;
+			glViewport(black_bar, 0, my_width, screen_height);
+		}
 
-						const Sprite& sprite = alien_sprites[2 * (alien.type - 1)];
+		// - Take the newest tick, keeping the one before to interpolate from.
+		//   Acquiring hands the old slot back to the writer, so the old
+		//   tick is only read from the local copy in last_game.
+		const GameSnapshot* latest = snapshot;
+		if (handoff_acquire(handoff, &latest))
+		{
+			updates += snapshot ? latest->tick - last_tick : 1;
+			prev_game = snapshot && latest->tick == last_tick + 1 ? last_game : latest->game;
+			last_game = latest->game;
+			last_tick = latest->tick;
+			snapshot = latest;
+		}
+		if (!snapshot)
+		{
+			glfwWaitEventsTimeout(limitFPS);
+			continue;
+		}
 
-						alien.x = 16 * xi + alien_swarm_position + (alien_death_sprite.width - sprite.width) / 2;
-						alien.y = 17 * yi + 128;
-					}
-				}
-			}
+		// - Draw one tick behind, alpha of the way to the newest one
+		double alpha = (glfwGetTime() - snapshot->time) / limitFPS;
+		game_interpolate(draw_game, prev_game, snapshot->game, alpha);
+		game_draw(renderer, draw_game, show_profile ? &overlay_summary : NULL);
 
-			// Process events
-			if (fire_pressed && game.num_bullets < GAME_MAX_BULLETS)
+		// - Only upload and present when something was redrawn
+		size_t num_rects = renderer_take_rects(renderer);
+		if (num_rects > 0 || window_resize)
+		{
+			profile_begin(PROFILE_UPLOAD);
+			upload_rects(&upload, buffer, renderer->rects, num_rects);
+			profile_end(PROFILE_UPLOAD);
+
+			profile_begin(PROFILE_DRAW_CALL);
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			profile_end(PROFILE_DRAW_CALL);
+
+			pacer_wait(&pacer);
+			profile_begin(PROFILE_SWAP);
+			glfwSwapBuffers(window);
+			profile_end(PROFILE_SWAP);
+			pacer_presented(&pacer);
+			if (snapshot->input_serial != input_serial)
 			{
-				game.bullets[game.num_bullets].x = game.player.x + player_sprite.width / 2;
-				game.bullets[game.num_bullets].y = game.player.y + player_sprite.height;
-				game.bullets[game.num_bullets].dir = 2;
-				++game.num_bullets;
-				SoundEngine->play2D("audio/player_shoot.wav", false);
+				input_serial = snapshot->input_serial;
+				double latency = glfwGetTime() - snapshot->input_time;
+				latency_sum += latency;
+				if (latency > latency_max) latency_max = latency;
+				latency_count++;
 			}
-			fire_pressed = false;
+			window_resize = false;
+			frames++;
 			glfwPollEvents();
 		}
-		// - Render at maximum possible frames
-
-		glTexSubImage2D(
-			GL_TEXTURE_2D, 0, 0, 0,
-			buffer.width, buffer.height,
-			GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,
-			buffer.data
-		);
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-		glfwSwapBuffers(window);
-		frames++;
+		else
+		{
+			// - Nothing new, sleep until the next interpolation step or input
+			pacer_skipped(&pacer);
+			glfwWaitEventsTimeout(limitFPS / 4);
+		}
+		profile_commit(profiler);
 
+		if (cycle_pacing)
+		{
+			cycle_pacing = false;
+			pacer_set_mode(&pacer, PacingMode((pacer.mode + 1) % PACING_MODE_COUNT));
+			glfwSwapInterval(pacer_swap_interval(&pacer));
+			printf("Pacing: %s\n", pacing_mode_names[pacer.mode]);
+		}
 
 		// - Reset after one second
 		if (glfwGetTime() - timer > 1.0) {
 			timer++;
-			updateWindowTitle(window, frames, alien_update_frequency);
+			updateWindowTitle(window, frames, snapshot->game.alien_update_frequency);
+			profile_summarize(render_profiler, &overlay_summary);
+			profile_merge(&overlay_summary, snapshot->profile);
 			std::cout << "FPS: " << frames << " Updates:" << updates << std::endl;
+			PacingStats pacing;
+			pacer_stats(&pacer, &pacing);
+			printf("Pacing %s: target %.2f ms, mean %.2f ms, jitter %.3f ms, max %.2f ms, missed %zu\n",
+				pacing_mode_names[pacer.mode], pacing.target_ms, pacing.mean_ms, pacing.stddev_ms,
+				pacing.max_ms, pacing.missed);
+			if (latency_count > 0)
+			{
+				printf("Input latency: mean %.1f ms, max %.1f ms over %zu inputs\n",
+					latency_sum / latency_count * 1000, latency_max * 1000, latency_count);
+				latency_sum = latency_max = 0;
+				latency_count = 0;
+			}
 			updates = 0, frames = 0;
 		}
 	}
-	write_high_score(high_score);
-	glfwDestroyWindow(window);
-	glfwTerminate();
 
-	glDeleteVertexArrays(1, &fullscreen_triangle_vao);
+	game_running = false;
+	simulation.join();
+	delete handoff;
 
-	for (size_t i = 0; i < 6; ++i)
+	if (profile_path)
+	{
+		const Profiler* profilers[2] = { sim_profiler, render_profiler };
+		profile_write_csv(profile_path, profilers, 2);
+	}
+	profiler = NULL;
+	delete sim_profiler;
+	delete render_profiler;
+	if (io.replay)
 	{
-		delete[] alien_sprites[i].data;
+		replay_close_read(io.replay);
+		delete io.replay;
 	}
 
-	delete[] text_spritesheet.data;
-	delete[] alien_death_sprite.data;
-	delete[] player_bullet_sprite.data;
-	delete[] alien_bullet_sprite[0].data;
-	delete[] alien_bullet_sprite[1].data;
-	delete[] alien_bullet_animation.frames;
+	// Quitting mid-game still counts the game
+	if (io.leaderboard && game.player.life > 0 && game.score > 0)
+		leaderboard_submit(leaderboard, uint32_t(game.score), uint32_t(game.level));
+	leaderboard_close(leaderboard);
+	upload_free(&upload);
+	glDeleteVertexArrays(1, &fullscreen_triangle_vao);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	close_audio();
+	bundle_close(&assets);
+#endif
 
-	for (size_t i = 0; i < 3; ++i)
+	if (recording)
 	{
-		delete[] alien_animation[i].frames;
+		replay_close_write(recording, game);
+		delete recording;
 	}
+
+	renderer_free(renderer);
+	delete renderer;
 	delete[] buffer.data;
-	delete[] game.aliens;
-	delete[] death_counters;
+	delete leaderboard;
 	return 0;
-}
\ No newline at end of file
+}
@@ -1,2 +1,16 @@
 #!/bin/bash
-g++ -Wall -std=c++11 -O0 -g -o main -lglfw -lglew -framework OpenGL main.cpp
+ENGINE="game.cpp sprites.cpp render.cpp batch.cpp handoff.cpp replay.cpp savestate.cpp profile.cpp audio.cpp framedump.cpp upload.cpp pacing.cpp input.cpp bundle.cpp leaderboard.cpp rng.cpp"
+SOURCES="main.cpp $ENGINE"
+
+if [ "$1" == "pack" ]; then
+	# Asset bundle next to the executables
+	g++ -Wall -std=c++14 -O2 -pthread -DHEADLESS $CXXFLAGS -o pack pack.cpp $ENGINE && ./pack assets.bin
+elif [ "$1" == "bench" ]; then
+	# Microbenchmarks, prints CSV
+	g++ -Wall -std=c++14 -O2 -pthread -DHEADLESS $CXXFLAGS -o bench bench.cpp $ENGINE
+elif [ "$1" == "headless" ]; then
+	# No GLFW, GLEW or irrKlang needed, runs the simulation as fast as possible
+	g++ -Wall -std=c++14 -O2 -pthread -DHEADLESS $CXXFLAGS -o main_headless $SOURCES
+else
+	g++ -Wall -std=c++14 -O0 -g -pthread -o main -lglfw -lglew -framework OpenGL $CXXFLAGS $SOURCES
+fi
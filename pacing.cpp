@@ -0,0 +1,142 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "pacing.h"
+
+const char* pacing_mode_names[PACING_MODE_COUNT] = {
+	"off",
+	"vsync",
+	"cap",
+	"adaptive"
+};
+
+static double pacer_now(const Pacer* pacer)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - pacer->epoch).count();
+}
+
+void pacer_init(Pacer* pacer, PacingMode mode, double cap_fps, double refresh_fps)
+{
+	pacer->cap_fps = cap_fps > 0 ? cap_fps : 60;
+	pacer->refresh_fps = refresh_fps > 0 ? refresh_fps : 60;
+	pacer->epoch = std::chrono::steady_clock::now();
+	pacer->spin_margin = 0.002;
+	pacer_set_mode(pacer, mode);
+}
+
+void pacer_set_mode(Pacer* pacer, PacingMode mode)
+{
+	pacer->mode = mode;
+	pacer->target_fps = mode == PACING_CAP ? pacer->cap_fps : pacer->refresh_fps;
+	pacer->deadline = pacer_now(pacer);
+	pacer->last_present = -1;
+	pacer->num_samples = 0;
+}
+
+int pacer_swap_interval(const Pacer* pacer)
+{
+	return pacer->mode == PACING_VSYNC ? 1 : 0;
+}
+
+void pacer_wait(Pacer* pacer)
+{
+	if (pacer->mode != PACING_CAP && pacer->mode != PACING_ADAPTIVE)
+		return;
+
+	double period = 1.0 / pacer->target_fps;
+	double now = pacer_now(pacer);
+	// Late by more than a frame, start over from now rather than rushing
+	// out frames to catch up
+	if (now - pacer->deadline > period)
+		pacer->deadline = now;
+
+	// The OS sleep overshoots by a varying amount, so sleep until a margin
+	// before the deadline and spin the rest. The margin tracks the worst
+	// recent overshoot and slowly shrinks back.
+	double sleep = pacer->deadline - now - pacer->spin_margin;
+	if (sleep > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(sleep));
+		double overshoot = pacer_now(pacer) - (now + sleep);
+		double margin = pacer->spin_margin * 0.99;
+		if (overshoot * 1.5 > margin) margin = overshoot * 1.5;
+		pacer->spin_margin = margin < 0.0002 ? 0.0002 : (margin > 0.004 ? 0.004 : margin);
+	}
+	while (pacer_now(pacer) < pacer->deadline)
+		std::this_thread::yield();
+	pacer->deadline += period;
+}
+
+void pacer_presented(Pacer* pacer)
+{
+	double now = pacer_now(pacer);
+	if (pacer->last_present >= 0 && pacer->num_samples < PACING_MAX_SAMPLES)
+		pacer->samples[pacer->num_samples++] = float(now - pacer->last_present);
+	pacer->last_present = now;
+}
+
+void pacer_skipped(Pacer* pacer)
+{
+	pacer->last_present = -1;
+}
+
+void pacer_stats(Pacer* pacer, PacingStats* stats)
+{
+	double period = 1.0 / pacer->target_fps;
+	size_t n = pacer->num_samples;
+	double sum = 0, sum_sq = 0, max = 0;
+	size_t missed = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		double s = pacer->samples[i];
+		sum += s;
+		sum_sq += s * s;
+		if (s > max) max = s;
+		if (s > period * 1.2) ++missed;
+	}
+	double mean = n ? sum / n : 0;
+	double variance = n ? sum_sq / n - mean * mean : 0;
+
+	stats->frames = n;
+	stats->target_ms = pacer->mode == PACING_CAP || pacer->mode == PACING_ADAPTIVE ? period * 1000 : 0;
+	stats->mean_ms = mean * 1000;
+	stats->stddev_ms = std::sqrt(variance > 0 ? variance : 0) * 1000;
+	stats->max_ms = max * 1000;
+	stats->missed = missed;
+	pacer->num_samples = 0;
+
+	if (pacer->mode == PACING_ADAPTIVE && n > 0)
+	{
+		if (missed * 10 > n && pacer->target_fps > 30)
+			pacer->target_fps /= 2;
+		else if (missed == 0 && pacer->target_fps * 2 <= pacer->refresh_fps)
+			pacer->target_fps *= 2;
+	}
+}
+
+bool pacing_parse(const char* text, PacingMode* mode, double* cap_fps)
+{
+	for (int m = 0; m < PACING_MODE_COUNT; ++m)
+	{
+		size_t len = strlen(pacing_mode_names[m]);
+		if (strncmp(text, pacing_mode_names[m], len) != 0)
+			continue;
+		if (text[len] == '\0')
+		{
+			*mode = PacingMode(m);
+			return true;
+		}
+		if (m == PACING_CAP && text[len] == ':')
+		{
+			// Leave the outputs alone when the rate is unusable
+			double fps = std::atof(text + len + 1);
+			if (fps <= 0)
+				return false;
+			*mode = PACING_CAP;
+			*cap_fps = fps;
+			return true;
+		}
+	}
+	return false;
+}
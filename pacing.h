@@ -0,0 +1,69 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+// How the main loop spaces out presented frames:
+//
+//   off       present as soon as a frame changed, no limit
+//   vsync     swap interval 1, the swap blocks until the display refresh
+//   cap       sleep most of the way to a fixed frame rate, then spin the
+//             rest, for accurate pacing without holding a core
+//   adaptive  cap at the display refresh rate, halving it for the next
+//             second when too many frames miss their deadline and going
+//             back up after a clean second
+enum PacingMode
+{
+	PACING_OFF,
+	PACING_VSYNC,
+	PACING_CAP,
+	PACING_ADAPTIVE,
+	PACING_MODE_COUNT
+};
+
+extern const char* pacing_mode_names[PACING_MODE_COUNT];
+
+// Intervals between presented frames over the last stats window
+struct PacingStats
+{
+	size_t frames;
+	double target_ms;
+	double mean_ms, stddev_ms, max_ms;
+	size_t missed; // Intervals over 1.2 target periods
+};
+
+#define PACING_MAX_SAMPLES 2048
+
+struct Pacer
+{
+	PacingMode mode;
+	double cap_fps; // Target for PACING_CAP
+	double refresh_fps; // Display rate, the most PACING_ADAPTIVE asks for
+	double target_fps; // Current target of cap and adaptive
+	std::chrono::steady_clock::time_point epoch;
+	double deadline; // Seconds since epoch the next frame is due
+	double last_present;
+	double spin_margin; // Sleep this much short of the deadline
+	size_t num_samples;
+	float samples[PACING_MAX_SAMPLES]; // Intervals in seconds
+};
+
+void pacer_init(Pacer* pacer, PacingMode mode, double cap_fps, double refresh_fps);
+void pacer_set_mode(Pacer* pacer, PacingMode mode);
+
+// Swap interval to pass to the windowing system for the current mode
+int pacer_swap_interval(const Pacer* pacer);
+
+// Call right before presenting; blocks until the frame is due
+void pacer_wait(Pacer* pacer);
+// Call right after presenting
+void pacer_presented(Pacer* pacer);
+// Call when a frame was skipped because nothing changed, so the gap to
+// the next one is not counted as jitter
+void pacer_skipped(Pacer* pacer);
+
+// Summarizes the window since the last call and starts a new one. In
+// adaptive mode this is also where the target rate changes.
+void pacer_stats(Pacer* pacer, PacingStats* stats);
+
+// "cap:120" for a 120 fps cap, or one of pacing_mode_names
+bool pacing_parse(const char* text, PacingMode* mode, double* cap_fps);
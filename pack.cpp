@@ -0,0 +1,42 @@
+// Packs the decoded sounds into one asset bundle, then maps it back in
+// and checks every entry against its source.
+//
+// Usage: pack [output]   (default assets.bin, run from the repo root)
+
+#include <cstdio>
+#include <cstring>
+#include "audio.h"
+#include "bundle.h"
+
+int main(int argc, char* argv[])
+{
+	const char* path = argc > 1 ? argv[1] : "assets.bin";
+
+	BundleWriter writer;
+	AudioClip clips[AUDIO_SOUND_COUNT];
+	for (size_t i = 0; i < AUDIO_SOUND_COUNT; ++i)
+	{
+		if (!audio_load_wav(&clips[i], audio_sound_paths[i]))
+			return 1;
+		bundle_add(&writer, audio_sound_paths[i], BUNDLE_PCM, clips[i].sample_rate, 0, 0,
+			clips[i].samples, clips[i].num_frames * sizeof(int16_t));
+	}
+	if (!bundle_write(&writer, path))
+		return 1;
+
+	Bundle bundle;
+	if (!bundle_open(&bundle, path))
+		return 1;
+	bool ok = true;
+	for (size_t i = 0; i < AUDIO_SOUND_COUNT; ++i)
+	{
+		BundleItem item;
+		ok = ok && bundle_find(&bundle, audio_sound_paths[i], BUNDLE_PCM, &item) &&
+			item.a == clips[i].sample_rate && item.size == clips[i].num_frames * sizeof(int16_t) &&
+			memcmp(item.data, clips[i].samples, item.size) == 0;
+		audio_clip_free(&clips[i]);
+	}
+	printf("%s: %u entries, %zu bytes, %s\n", path, bundle.num_entries, bundle.size, ok ? "verified" : "VERIFY FAILED");
+	bundle_close(&bundle);
+	return ok ? 0 : 1;
+}
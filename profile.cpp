@@ -0,0 +1,153 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "profile.h"
+
+thread_local Profiler* profiler = NULL;
+
+const char* profile_stage_names[PROFILE_STAGE_COUNT] = {
+	"TICK",
+	"BULLETS",
+	"COLLISION",
+	"SWARM",
+	"CLEAR",
+	"HUD",
+	"ALIENS",
+	"BULLET DRAW",
+	"PLAYER",
+	"UPLOAD",
+	"DRAW CALL",
+	"SWAP"
+};
+
+static void profile_clear_stats(ProfileStats* stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->min_ns = UINT64_MAX;
+}
+
+void profile_reset(Profiler* p)
+{
+	for (size_t s = 0; s < PROFILE_STAGE_COUNT; ++s)
+	{
+		p->pending_ns[s] = 0;
+		p->touched[s] = false;
+		profile_clear_stats(&p->window[s]);
+		profile_clear_stats(&p->total[s]);
+	}
+}
+
+static size_t profile_bucket(uint64_t ns)
+{
+	if (ns < 1) return 0;
+	size_t bucket = (size_t)(4.0 * log2((double)ns));
+	return bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1;
+}
+
+// Upper edge of a bucket
+static double profile_bucket_ns(size_t bucket)
+{
+	return exp2((bucket + 1) / 4.0);
+}
+
+static void profile_add(ProfileStats* stats, uint64_t ns)
+{
+	stats->count++;
+	stats->total_ns += ns;
+	if (ns < stats->min_ns) stats->min_ns = ns;
+	if (ns > stats->max_ns) stats->max_ns = ns;
+	stats->buckets[profile_bucket(ns)]++;
+}
+
+void profile_commit(Profiler* p)
+{
+	for (size_t s = 0; s < PROFILE_STAGE_COUNT; ++s)
+	{
+		if (!p->touched[s]) continue;
+		profile_add(&p->window[s], p->pending_ns[s]);
+		profile_add(&p->total[s], p->pending_ns[s]);
+		p->pending_ns[s] = 0;
+		p->touched[s] = false;
+	}
+}
+
+static double profile_p99_ns(const ProfileStats& stats)
+{
+	uint64_t rank = stats.count - stats.count / 100;
+	uint64_t seen = 0;
+	for (size_t b = 0; b < PROFILE_BUCKETS; ++b)
+	{
+		seen += stats.buckets[b];
+		if (seen >= rank)
+		{
+			double edge = profile_bucket_ns(b);
+			return edge < (double)stats.max_ns ? edge : (double)stats.max_ns;
+		}
+	}
+	return (double)stats.max_ns;
+}
+
+void profile_summarize(Profiler* p, ProfileSummary* summary)
+{
+	for (size_t s = 0; s < PROFILE_STAGE_COUNT; ++s)
+	{
+		const ProfileStats& stats = p->window[s];
+		summary->count[s] = stats.count;
+		if (stats.count == 0)
+		{
+			summary->min_us[s] = summary->avg_us[s] = summary->p99_us[s] = 0.0f;
+			continue;
+		}
+		summary->min_us[s] = stats.min_ns / 1000.0f;
+		summary->avg_us[s] = (float)(stats.total_ns / 1000.0 / stats.count);
+		summary->p99_us[s] = (float)(profile_p99_ns(stats) / 1000.0);
+		profile_clear_stats(&p->window[s]);
+	}
+}
+
+void profile_merge(ProfileSummary* into, const ProfileSummary& from)
+{
+	for (size_t s = 0; s < PROFILE_STAGE_COUNT; ++s)
+	{
+		if (from.count[s] == 0) continue;
+		into->count[s] = from.count[s];
+		into->min_us[s] = from.min_us[s];
+		into->avg_us[s] = from.avg_us[s];
+		into->p99_us[s] = from.p99_us[s];
+	}
+}
+
+bool profile_write_csv(const char* path, const Profiler* const* profilers, size_t num_profilers)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		fprintf(stderr, "Error: could not create %s\n", path);
+		return false;
+	}
+
+	fprintf(file, "stage,count,min_us,avg_us,p99_us,max_us");
+	for (size_t b = 0; b < PROFILE_BUCKETS; ++b)
+		fprintf(file, ",le_%.1f_ns", profile_bucket_ns(b));
+	fprintf(file, "\n");
+
+	for (size_t i = 0; i < num_profilers; ++i)
+	{
+		for (size_t s = 0; s < PROFILE_STAGE_COUNT; ++s)
+		{
+			const ProfileStats& stats = profilers[i]->total[s];
+			if (stats.count == 0) continue;
+			fprintf(file, "%s,%llu,%.3f,%.3f,%.3f,%.3f", profile_stage_names[s],
+				(unsigned long long)stats.count, stats.min_ns / 1000.0,
+				stats.total_ns / 1000.0 / stats.count, profile_p99_ns(stats) / 1000.0,
+				stats.max_ns / 1000.0);
+			for (size_t b = 0; b < PROFILE_BUCKETS; ++b)
+				fprintf(file, ",%u", stats.buckets[b]);
+			fprintf(file, "\n");
+		}
+	}
+
+	bool ok = !ferror(file);
+	ok = fclose(file) == 0 && ok;
+	return ok;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Stages of a tick and a frame. Bullet collision runs inside the bullet
+// loop, so PROFILE_SIM_COLLISION is also counted in PROFILE_SIM_BULLETS.
+enum ProfileStage
+{
+	PROFILE_SIM_TICK,
+	PROFILE_SIM_BULLETS,
+	PROFILE_SIM_COLLISION,
+	PROFILE_SIM_SWARM,
+	PROFILE_DRAW_CLEAR,
+	PROFILE_DRAW_HUD,
+	PROFILE_DRAW_ALIENS,
+	PROFILE_DRAW_BULLETS,
+	PROFILE_DRAW_PLAYER,
+	PROFILE_UPLOAD,
+	PROFILE_DRAW_CALL,
+	PROFILE_SWAP,
+	PROFILE_STAGE_COUNT
+};
+
+// Log-scale histogram of per-frame stage times, 4 buckets per doubling
+// of nanoseconds, so p99 is good to about 20%
+#define PROFILE_BUCKETS 128
+
+struct ProfileStats
+{
+	uint64_t count;
+	uint64_t total_ns, min_ns, max_ns;
+	uint32_t buckets[PROFILE_BUCKETS];
+};
+
+// What the overlay shows, in microseconds. count == 0 for stages that did
+// not run.
+struct ProfileSummary
+{
+	uint64_t count[PROFILE_STAGE_COUNT];
+	float min_us[PROFILE_STAGE_COUNT];
+	float avg_us[PROFILE_STAGE_COUNT];
+	float p99_us[PROFILE_STAGE_COUNT];
+};
+
+// Time spent in a stage adds up in pending until profile_commit files it
+// as one sample, so a stage entered many times in a tick counts once.
+// `window` restarts with every profile_summarize, `total` never does.
+struct Profiler
+{
+	std::chrono::steady_clock::time_point started[PROFILE_STAGE_COUNT];
+	uint64_t pending_ns[PROFILE_STAGE_COUNT];
+	bool touched[PROFILE_STAGE_COUNT];
+	ProfileStats window[PROFILE_STAGE_COUNT];
+	ProfileStats total[PROFILE_STAGE_COUNT];
+};
+
+// The calling thread's profiler, NULL turns every timer into a branch.
+// Each thread that steps or draws sets its own.
+extern thread_local Profiler* profiler;
+
+void profile_reset(Profiler* p);
+
+inline void profile_begin(ProfileStage stage)
+{
+	if (profiler)
+		profiler->started[stage] = std::chrono::steady_clock::now();
+}
+
+inline void profile_end(ProfileStage stage)
+{
+	if (!profiler) return;
+	std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - profiler->started[stage];
+	profiler->pending_ns[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	profiler->touched[stage] = true;
+}
+
+struct ProfileScope
+{
+	ProfileStage stage;
+	ProfileScope(ProfileStage stage) : stage(stage) { profile_begin(stage); }
+	~ProfileScope() { profile_end(stage); }
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(stage)
+
+// File the pending time of every stage touched since the last commit
+void profile_commit(Profiler* p);
+
+// Summary of the window so far, then start a new window
+void profile_summarize(Profiler* p, ProfileSummary* summary);
+
+// Take every stage that ran in from over into into
+void profile_merge(ProfileSummary* into, const ProfileSummary& from);
+
+// One row per stage that ran with count, min, avg, p99 and max in
+// microseconds, then the histogram buckets
+bool profile_write_csv(const char* path, const Profiler* const* profilers, size_t num_profilers);
+
+extern const char* profile_stage_names[PROFILE_STAGE_COUNT];
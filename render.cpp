@@ -0,0 +1,675 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "render.h"
+#include "game.h"
+#include "simd.h"
+
+void buffer_clear(Buffer* buffer, uint32_t color)
+{
+	for (size_t i = 0; i < buffer->width * buffer->height; ++i)
+	{
+		buffer->data[i] = color;
+	}
+}
+
+void buffer_draw_sprite_bytes(Buffer* buffer, const Sprite& sprite, size_t x, size_t y, uint32_t color)
+{
+	if (!color)
+		color = sprite.color;
+	for (size_t xi = 0; xi < sprite.width; ++xi)
+	{
+		for (size_t yi = 0; yi < sprite.height; ++yi)
+		{
+			if (sprite.data[yi * sprite.width + xi] &&
+				(sprite.height - 1 + y - yi) < buffer->height &&
+				(x + xi) < buffer->width)
+			{
+				buffer->data[(sprite.height - 1 + y - yi) * buffer->width + (x + xi)] = color;
+			}
+		}
+	}
+}
+
+#if defined(__AVX2__)
+// Mask rows of a sprite W pixels wide with no columns clipped. With W
+// known the fill's length checks fold away and the AVX2 loop runs a
+// fixed number of times.
+template <size_t W>
+static void blit_rows(uint32_t* row, size_t stride, const uint64_t* masks, ptrdiff_t y0, ptrdiff_t y1, uint32_t color)
+{
+	for (ptrdiff_t yi = y0; yi < y1; ++yi, row -= stride)
+	{
+		uint64_t bits = masks[yi];
+		if (bits)
+			simd_fill_masked_u32(row, bits, W, color);
+	}
+}
+#endif
+
+static void blit_rows_masked(uint32_t* row, size_t stride, const uint64_t* masks, ptrdiff_t y0, ptrdiff_t y1,
+	ptrdiff_t x0, ptrdiff_t x1, uint32_t color)
+{
+	for (ptrdiff_t yi = y0; yi < y1; ++yi, row -= stride)
+	{
+		uint64_t bits = masks[yi] >> x0;
+		if (bits)
+			simd_fill_masked_u32(row, bits, x1 - x0, color);
+	}
+}
+
+void buffer_draw_sprite_clipped(Buffer* buffer, const Sprite& sprite, size_t x, size_t y, uint32_t color, const DirtyRect& clip)
+{
+	if (!color)
+		color = sprite.color;
+
+	// Coordinates past the left or bottom edge arrive wrapped around as
+	// huge size_t values, so do the math signed
+	ptrdiff_t sx = (ptrdiff_t)x;
+	ptrdiff_t top = (ptrdiff_t)(y + sprite.height - 1);
+	ptrdiff_t cx0 = (ptrdiff_t)clip.x, cx1 = (ptrdiff_t)(clip.x + clip.width);
+	ptrdiff_t cy0 = (ptrdiff_t)clip.y, cy1 = (ptrdiff_t)(clip.y + clip.height);
+
+	if (!sprite.data)
+	{
+		// Solid rectangle, rows y to top
+		ptrdiff_t fx0 = sx > cx0 ? sx : cx0;
+		ptrdiff_t fx1 = sx + (ptrdiff_t)sprite.width < cx1 ? sx + (ptrdiff_t)sprite.width : cx1;
+		ptrdiff_t fy0 = top - (ptrdiff_t)sprite.height + 1;
+		if (fy0 < cy0) fy0 = cy0;
+		ptrdiff_t fy1 = top + 1 < cy1 ? top + 1 : cy1;
+		for (ptrdiff_t yi = fy0; yi < fy1; ++yi)
+			for (ptrdiff_t xi = fx0; xi < fx1; ++xi)
+				buffer->data[yi * buffer->width + xi] = color;
+		return;
+	}
+
+	if (!sprite.masks || sprite.width > 64)
+	{
+		for (size_t yi = 0; yi < sprite.height; ++yi)
+		{
+			ptrdiff_t row = top - (ptrdiff_t)yi;
+			if (row < cy0 || row >= cy1) continue;
+			for (size_t xi = 0; xi < sprite.width; ++xi)
+			{
+				ptrdiff_t col = sx + (ptrdiff_t)xi;
+				if (sprite.data[yi * sprite.width + xi] && col >= cx0 && col < cx1)
+					buffer->data[row * buffer->width + col] = color;
+			}
+		}
+		return;
+	}
+
+	// Clip once, in sprite space. Data row yi lands on buffer row top - yi.
+	ptrdiff_t x0 = cx0 - sx > 0 ? cx0 - sx : 0;
+	ptrdiff_t x1 = (ptrdiff_t)sprite.width;
+	if (sx + x1 > cx1) x1 = cx1 - sx;
+	ptrdiff_t y0 = top - cy1 + 1 > 0 ? top - cy1 + 1 : 0;
+	ptrdiff_t y1 = (ptrdiff_t)sprite.height;
+	if (top - y1 + 1 < cy0) y1 = top - cy0 + 1;
+	if (x0 >= x1 || y0 >= y1) return;
+
+	uint32_t* row = buffer->data + (top - y0) * buffer->width + sx + x0;
+#if defined(__AVX2__)
+	// Unclipped sprites of every width the game draws. Only pays off for
+	// the fixed-length AVX2 fill; the scalar fill already skips unset
+	// bits and measured slower behind the extra branch.
+	if (x0 == 0 && x1 == (ptrdiff_t)sprite.width)
+	{
+		switch (sprite.width)
+		{
+		case 1: blit_rows<1>(row, buffer->width, sprite.masks, y0, y1, color); return;
+		case 3: blit_rows<3>(row, buffer->width, sprite.masks, y0, y1, color); return;
+		case 5: blit_rows<5>(row, buffer->width, sprite.masks, y0, y1, color); return;
+		case 8: blit_rows<8>(row, buffer->width, sprite.masks, y0, y1, color); return;
+		case 11: blit_rows<11>(row, buffer->width, sprite.masks, y0, y1, color); return;
+		case 12: blit_rows<12>(row, buffer->width, sprite.masks, y0, y1, color); return;
+		case 13: blit_rows<13>(row, buffer->width, sprite.masks, y0, y1, color); return;
+		}
+	}
+#endif
+	blit_rows_masked(row, buffer->width, sprite.masks, y0, y1, x0, x1, color);
+}
+
+void buffer_draw_sprite(Buffer* buffer, const Sprite& sprite, size_t x, size_t y, uint32_t color)
+{
+	DirtyRect clip = { 0, 0, buffer->width, buffer->height };
+	buffer_draw_sprite_clipped(buffer, sprite, x, y, color, clip);
+}
+
+// Decimal digits of number, most significant first. Returns the count.
+static size_t number_digits(size_t number, uint8_t digits[20])
+{
+	uint8_t reversed[20];
+	size_t num_digits = 0;
+	do
+	{
+		reversed[num_digits++] = number % 10;
+		number = number / 10;
+	} while (number > 0);
+
+	for (size_t i = 0; i < num_digits; ++i)
+		digits[i] = reversed[num_digits - i - 1];
+	return num_digits;
+}
+
+// Frame index of a sheet such as text_spritesheet as a sprite of its own
+static Sprite sprite_sheet_frame(const Sprite& sheet, size_t index)
+{
+	Sprite sprite = sheet;
+	sprite.data = sheet.data + index * sheet.width * sheet.height;
+	if (sheet.masks)
+		sprite.masks = sheet.masks + index * sheet.height;
+	return sprite;
+}
+
+void buffer_draw_number(
+	Buffer* buffer,
+	const Sprite& number_spritesheet, size_t number,
+	size_t x, size_t y,
+	uint32_t color)
+{
+	uint8_t digits[20];
+	size_t num_digits = number_digits(number, digits);
+
+	size_t xp = x;
+	for (size_t i = 0; i < num_digits; ++i)
+	{
+		Sprite sprite = sprite_sheet_frame(number_spritesheet, digits[i]);
+		buffer_draw_sprite(buffer, sprite, xp, y, color);
+		xp += sprite.width + 1;
+	}
+}
+
+void buffer_draw_text(
+	Buffer* buffer,
+	const Sprite& text_spritesheet,
+	const char* text,
+	size_t x, size_t y,
+	uint32_t color)
+{
+	size_t xp = x;
+	for (const char* charp = text; *charp != '\0'; ++charp)
+	{
+		char character = *charp - 32;
+		if (character < 0 || character >= 65) continue;
+
+		Sprite sprite = sprite_sheet_frame(text_spritesheet, character);
+		buffer_draw_sprite(buffer, sprite, xp, y, color);
+		xp += sprite.width + 1;
+	}
+}
+
+void renderer_init(Renderer* renderer, Buffer* buffer)
+{
+	renderer->buffer = buffer;
+	renderer->tiles_x = (buffer->width + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+	renderer->tiles_y = (buffer->height + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+	if (renderer->tiles_x * renderer->tiles_y > RENDER_MAX_TILES)
+	{
+		// Too big to track, fall back to full-width row bands, each tall
+		// enough that the bands fit in RENDER_MAX_TILES and no band
+		// starts past the bottom of the buffer
+		size_t band = (buffer->height + RENDER_MAX_TILES - 1) / RENDER_MAX_TILES;
+		renderer->tiles_x = 1;
+		renderer->tiles_y = (buffer->height + band - 1) / band;
+	}
+	renderer->redraw_all = true;
+	renderer->stage = PROFILE_DRAW_PLAYER;
+	renderer->num_draws = 0;
+	renderer->num_rects = 0;
+	for (size_t t = 0; t < RENDER_MAX_TILES; ++t)
+	{
+		renderer->tile_hash[t] = 0;
+		renderer->tile_dirty[t] = false;
+		renderer->tile_pending[t] = false;
+	}
+
+	HudLayer& hud = renderer->hud;
+	hud.layer.image.width = hud.scratch.width = buffer->width;
+	hud.layer.image.height = hud.scratch.height = buffer->height;
+	hud.layer.image.data = new uint32_t[buffer->width * buffer->height];
+	hud.scratch.data = new uint32_t[buffer->width * buffer->height];
+	buffer_clear(&hud.layer.image, 0);
+	for (size_t t = 0; t < RENDER_MAX_TILES; ++t)
+		hud.layer.tile_version[t] = 0;
+	hud.valid = false;
+}
+
+void renderer_free(Renderer* renderer)
+{
+	delete[] renderer->hud.layer.image.data;
+	delete[] renderer->hud.scratch.data;
+	renderer->hud.layer.image.data = NULL;
+	renderer->hud.scratch.data = NULL;
+}
+
+void renderer_begin(Renderer* renderer)
+{
+	renderer->num_draws = 0;
+}
+
+void renderer_sprite(Renderer* renderer, const Sprite& sprite, size_t x, size_t y, uint32_t color)
+{
+	if (renderer->num_draws == RENDER_MAX_DRAWS) return;
+	DrawCommand& draw = renderer->draws[renderer->num_draws++];
+	draw.sprite = sprite;
+	draw.x = x;
+	draw.y = y;
+	draw.color = color ? color : sprite.color;
+	draw.layer = NULL;
+	draw.stage = renderer->stage;
+}
+
+void renderer_layer(Renderer* renderer, const Layer& layer)
+{
+	if (renderer->num_draws == RENDER_MAX_DRAWS) return;
+	DrawCommand& draw = renderer->draws[renderer->num_draws++];
+	Sprite bounds = { layer.image.width, layer.image.height, 0, NULL, NULL };
+	draw.sprite = bounds;
+	draw.x = 0;
+	draw.y = 0;
+	draw.color = 0;
+	draw.layer = &layer;
+	draw.stage = renderer->stage;
+}
+
+void renderer_fill(Renderer* renderer, size_t x, size_t y, size_t width, size_t height, uint32_t color)
+{
+	Sprite rect = { width, height, color, NULL, NULL };
+	renderer_sprite(renderer, rect, x, y, color);
+}
+
+void renderer_number(Renderer* renderer, const Sprite& number_spritesheet, size_t number, size_t x, size_t y, uint32_t color)
+{
+	uint8_t digits[20];
+	size_t num_digits = number_digits(number, digits);
+
+	size_t xp = x;
+	for (size_t i = 0; i < num_digits; ++i)
+	{
+		Sprite sprite = sprite_sheet_frame(number_spritesheet, digits[i]);
+		renderer_sprite(renderer, sprite, xp, y, color);
+		xp += sprite.width + 1;
+	}
+}
+
+void renderer_text(Renderer* renderer, const Sprite& text_spritesheet, const char* text, size_t x, size_t y, uint32_t color)
+{
+	size_t xp = x;
+	for (const char* charp = text; *charp != '\0'; ++charp)
+	{
+		char character = *charp - 32;
+		if (character < 0 || character >= 65) continue;
+
+		Sprite sprite = sprite_sheet_frame(text_spritesheet, character);
+		if (character != 0) // Spaces draw nothing
+			renderer_sprite(renderer, sprite, xp, y, color);
+		xp += sprite.width + 1;
+	}
+}
+
+// Copy the non-zero pixels of a buffer-sized layer that fall inside clip
+static void buffer_draw_layer_clipped(Buffer* buffer, const Buffer& layer, const DirtyRect& clip)
+{
+	for (size_t y = clip.y; y < clip.y + clip.height; ++y)
+	{
+		const uint32_t* src = layer.data + y * layer.width;
+		uint32_t* dst = buffer->data + y * buffer->width;
+		for (size_t x = clip.x; x < clip.x + clip.width; ++x)
+		{
+			if (src[x])
+				dst[x] = src[x];
+		}
+	}
+}
+
+// Tile range [tx0, tx1) x [ty0, ty1) under a draw, false if it is off screen
+static bool renderer_draw_tiles(const Renderer* renderer, const DrawCommand& draw,
+	size_t* tx0, size_t* ty0, size_t* tx1, size_t* ty1)
+{
+	const Buffer* buffer = renderer->buffer;
+	ptrdiff_t x0 = (ptrdiff_t)draw.x, y0 = (ptrdiff_t)draw.y;
+	ptrdiff_t x1 = x0 + (ptrdiff_t)draw.sprite.width, y1 = y0 + (ptrdiff_t)draw.sprite.height;
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 > (ptrdiff_t)buffer->width) x1 = (ptrdiff_t)buffer->width;
+	if (y1 > (ptrdiff_t)buffer->height) y1 = (ptrdiff_t)buffer->height;
+	if (x0 >= x1 || y0 >= y1) return false;
+
+	size_t tile_w = (buffer->width + renderer->tiles_x - 1) / renderer->tiles_x;
+	size_t tile_h = (buffer->height + renderer->tiles_y - 1) / renderer->tiles_y;
+	*tx0 = x0 / tile_w;
+	*ty0 = y0 / tile_h;
+	*tx1 = (x1 - 1) / tile_w + 1;
+	*ty1 = (y1 - 1) / tile_h + 1;
+	return true;
+}
+
+static DirtyRect renderer_tile_rect(const Renderer* renderer, size_t tx, size_t ty)
+{
+	const Buffer* buffer = renderer->buffer;
+	size_t tile_w = (buffer->width + renderer->tiles_x - 1) / renderer->tiles_x;
+	size_t tile_h = (buffer->height + renderer->tiles_y - 1) / renderer->tiles_y;
+	DirtyRect rect = { tx * tile_w, ty * tile_h, tile_w, tile_h };
+	if (rect.x >= buffer->width) rect.width = 0;
+	else if (rect.x + rect.width > buffer->width) rect.width = buffer->width - rect.x;
+	if (rect.y >= buffer->height) rect.height = 0;
+	else if (rect.y + rect.height > buffer->height) rect.height = buffer->height - rect.y;
+	return rect;
+}
+
+static uint64_t hash_mix(uint64_t h, uint64_t v)
+{
+	h = (h ^ v) * 0x9E3779B97F4A7C15ull;
+	return h ^ (h >> 29);
+}
+
+void renderer_end(Renderer* renderer, uint32_t clear_color)
+{
+	Buffer* buffer = renderer->buffer;
+	const size_t num_tiles = renderer->tiles_x * renderer->tiles_y;
+	uint64_t hash[RENDER_MAX_TILES];
+	for (size_t t = 0; t < num_tiles; ++t)
+		hash[t] = hash_mix(0, clear_color);
+
+	// Everything that decides a draw's pixels goes into the hash of every
+	// tile it touches, in draw order
+	for (size_t i = 0; i < renderer->num_draws; ++i)
+	{
+		const DrawCommand& draw = renderer->draws[i];
+		size_t tx0, ty0, tx1, ty1;
+		if (!renderer_draw_tiles(renderer, draw, &tx0, &ty0, &tx1, &ty1)) continue;
+
+		// Mixed in one at a time: frames of a sheet move data and masks by
+		// strides that can XOR to the same value
+		uint64_t key = hash_mix(0, (uint64_t)(uintptr_t)draw.sprite.data);
+		key = hash_mix(key, (uint64_t)(uintptr_t)draw.sprite.masks);
+		key = hash_mix(key, (uint64_t)(uintptr_t)draw.layer);
+		key = hash_mix(key, ((uint64_t)draw.x << 32) | (uint32_t)draw.y);
+		key = hash_mix(key, ((uint64_t)draw.sprite.width << 32) | draw.sprite.height);
+		key = hash_mix(key, draw.color);
+		for (size_t ty = ty0; ty < ty1; ++ty)
+		{
+			for (size_t tx = tx0; tx < tx1; ++tx)
+			{
+				size_t t = ty * renderer->tiles_x + tx;
+				hash[t] = hash_mix(hash[t], draw.layer ? key + draw.layer->tile_version[t] : key);
+			}
+		}
+	}
+
+	profile_begin(PROFILE_DRAW_CLEAR);
+	for (size_t t = 0; t < num_tiles; ++t)
+	{
+		renderer->tile_dirty[t] = renderer->redraw_all || hash[t] != renderer->tile_hash[t];
+		renderer->tile_hash[t] = hash[t];
+		if (!renderer->tile_dirty[t]) continue;
+
+		renderer->tile_pending[t] = true;
+		DirtyRect rect = renderer_tile_rect(renderer, t % renderer->tiles_x, t / renderer->tiles_x);
+		for (size_t y = rect.y; y < rect.y + rect.height; ++y)
+			for (size_t x = rect.x; x < rect.x + rect.width; ++x)
+				buffer->data[y * buffer->width + x] = clear_color;
+	}
+	renderer->redraw_all = false;
+	profile_end(PROFILE_DRAW_CLEAR);
+
+	// Replay the draws, each clipped to the dirty tiles it touches
+	for (size_t i = 0; i < renderer->num_draws; ++i)
+	{
+		const DrawCommand& draw = renderer->draws[i];
+		size_t tx0, ty0, tx1, ty1;
+		if (!renderer_draw_tiles(renderer, draw, &tx0, &ty0, &tx1, &ty1)) continue;
+
+		PROFILE_SCOPE(draw.stage);
+		for (size_t ty = ty0; ty < ty1; ++ty)
+		{
+			for (size_t tx = tx0; tx < tx1; ++tx)
+			{
+				if (!renderer->tile_dirty[ty * renderer->tiles_x + tx]) continue;
+				DirtyRect clip = renderer_tile_rect(renderer, tx, ty);
+				if (draw.layer)
+					buffer_draw_layer_clipped(buffer, draw.layer->image, clip);
+				else
+					buffer_draw_sprite_clipped(buffer, draw.sprite, draw.x, draw.y, draw.color, clip);
+			}
+		}
+	}
+}
+
+size_t renderer_take_rects(Renderer* renderer)
+{
+	// Runs of pending tiles along each tile row, merged into the rectangle
+	// right below when they line up
+	size_t num_rects = 0;
+	for (size_t ty = 0; ty < renderer->tiles_y; ++ty)
+	{
+		bool* pending = renderer->tile_pending + ty * renderer->tiles_x;
+		for (size_t tx = 0; tx < renderer->tiles_x; )
+		{
+			if (!pending[tx]) { ++tx; continue; }
+
+			size_t run = tx;
+			while (run < renderer->tiles_x && pending[run])
+				pending[run++] = false;
+
+			DirtyRect first = renderer_tile_rect(renderer, tx, ty);
+			DirtyRect last = renderer_tile_rect(renderer, run - 1, ty);
+			DirtyRect rect = { first.x, first.y, last.x + last.width - first.x, first.height };
+			tx = run;
+			if (rect.width == 0 || rect.height == 0)
+				continue;
+
+			size_t r = 0;
+			while (r < num_rects)
+			{
+				DirtyRect& below = renderer->rects[r];
+				if (below.x == rect.x && below.width == rect.width && below.y + below.height == rect.y)
+					break;
+				++r;
+			}
+			if (r < num_rects)
+				renderer->rects[r].height += rect.height;
+			else
+				renderer->rects[num_rects++] = rect;
+		}
+	}
+	renderer->num_rects = num_rects;
+	return num_rects;
+}
+
+// Rasterize the HUD into scratch if anything on it changed, then copy
+// the tiles that differ into the layer and bump their versions
+static void hud_update(Renderer* renderer, const Game& game)
+{
+	HudLayer* hud = &renderer->hud;
+	if (hud->valid && hud->score == game.score && hud->high_score == game.high_score &&
+		hud->level == game.level && hud->life == game.player.life)
+	{
+		return;
+	}
+	hud->valid = true;
+	hud->score = game.score;
+	hud->high_score = game.high_score;
+	hud->level = game.level;
+	hud->life = game.player.life;
+
+	const uint32_t player_color = rgb_to_uint32(0, 255, 0); // Green
+	const uint32_t red_color = rgb_to_uint32(255, 0, 0); // Red
+
+	Buffer* buffer = &hud->scratch;
+	buffer_clear(buffer, 0);
+
+	// Every glyph is 5 wide with a 1px space after it
+	const int glyph_advance = text_spritesheet.width + 1;
+	uint8_t digits[20];
+
+	const int text_border_offset = 10;
+	const int score_txt_width = 5 * glyph_advance; // "SCORE"
+	int score_txt_pos = text_border_offset;
+	int score_width = number_digits(game.score, digits) * glyph_advance;
+	int score_pos = score_txt_pos + (score_txt_width / 2 - score_width / 2);
+	buffer_draw_text(buffer, text_spritesheet, "SCORE", score_txt_pos, game.height - text_spritesheet.height - 7, red_color);
+	buffer_draw_number(buffer, number_spritesheet, game.score, score_pos, game.height - 2 * number_spritesheet.height - 12, red_color);
+
+	//Draw High_Score - there is a 1px space between each character
+	const int high_score_txt_width = 10 * glyph_advance; // "HIGH SCORE"
+	int high_score_txt_pos = game.width - text_border_offset - high_score_txt_width;
+	int high_score_width = number_digits(game.high_score, digits) * glyph_advance;
+	int high_score_pos = (game.width - high_score_width) - (high_score_txt_width / 2 - high_score_width / 2) - text_border_offset;
+	buffer_draw_text(buffer, text_spritesheet, "HIGH SCORE", high_score_txt_pos, game.height - text_spritesheet.height - 7, red_color);
+	buffer_draw_number(buffer, number_spritesheet, game.high_score, high_score_pos, game.height - 2 * number_spritesheet.height - 12, red_color);
+
+	// "LEVEL n"
+	int level_text_width = (6 + number_digits(game.level, digits)) * glyph_advance;
+	int level_text_pos = (game.width - level_text_width) - text_border_offset;
+	buffer_draw_text(buffer, text_spritesheet, "LEVEL ", level_text_pos, text_spritesheet.height, red_color);
+	buffer_draw_number(buffer, number_spritesheet, game.level, level_text_pos + 6 * glyph_advance, text_spritesheet.height, red_color);
+
+	if (game.player.life == 0)
+	{
+		buffer_draw_text(buffer, text_spritesheet, "GAME OVER", game.width / 2 - 30, game.height / 2, red_color);
+	}
+	else
+	{
+		buffer_draw_number(buffer, number_spritesheet, game.player.life, 4, 7, red_color);
+		size_t xp = 11 + number_spritesheet.width;
+		for (size_t i = 0; i < game.player.life - 1; ++i)
+		{
+			//Lives Sprite
+			buffer_draw_sprite(buffer, player_sprite, xp, 7, player_color);
+			xp += player_sprite.width + 2;
+		}
+
+		//Line on Bottom
+		for (size_t i = 0; i < game.width; ++i)
+		{
+			buffer->data[game.width * 16 + i] = player_color;
+		}
+	}
+
+	Buffer* layer = &hud->layer.image;
+	for (size_t t = 0; t < renderer->tiles_x * renderer->tiles_y; ++t)
+	{
+		DirtyRect rect = renderer_tile_rect(renderer, t % renderer->tiles_x, t / renderer->tiles_x);
+		bool changed = false;
+		for (size_t y = rect.y; y < rect.y + rect.height; ++y)
+		{
+			size_t offset = y * layer->width + rect.x;
+			if (memcmp(layer->data + offset, buffer->data + offset, rect.width * sizeof(uint32_t)))
+			{
+				memcpy(layer->data + offset, buffer->data + offset, rect.width * sizeof(uint32_t));
+				changed = true;
+			}
+		}
+		if (changed)
+			++hud->layer.tile_version[t];
+	}
+}
+
+// One line per stage that ran: name, min, avg and p99 in milliseconds,
+// top left under the score. Drawing it is charged to PLAYER.
+static void profile_draw_overlay(Renderer* renderer, const ProfileSummary& summary)
+{
+	const uint32_t overlay_color = rgb_to_uint32(255, 255, 0); // Yellow
+	const size_t line_height = text_spritesheet.height + 2;
+	renderer->stage = PROFILE_DRAW_PLAYER;
+
+	size_t y = renderer->buffer->height - 44;
+	renderer_text(renderer, text_spritesheet, "STAGE        MIN   AVG   P99", 4, y, overlay_color);
+	for (size_t s = 0; s < PROFILE_STAGE_COUNT; ++s)
+	{
+		if (summary.count[s] == 0) continue;
+		y -= line_height;
+		char line[48];
+		snprintf(line, sizeof(line), "%-11s %5.2f %5.2f %5.2f", profile_stage_names[s],
+			summary.min_us[s] / 1000.0f, summary.avg_us[s] / 1000.0f, summary.p99_us[s] / 1000.0f);
+		renderer_text(renderer, text_spritesheet, line, 4, y, overlay_color);
+	}
+}
+
+void game_draw(Renderer* renderer, const Game& game, const ProfileSummary* overlay)
+{
+	const uint32_t alien_color = rgb_to_uint32(255, 255, 255); // White
+	const uint32_t player_color = rgb_to_uint32(0, 255, 0); // Green
+	const uint32_t clear_color = rgb_to_uint32(0, 0, 30); // Navy BLue
+
+	renderer_begin(renderer);
+
+	profile_begin(PROFILE_DRAW_HUD);
+	hud_update(renderer, game);
+	profile_end(PROFILE_DRAW_HUD);
+	renderer->stage = PROFILE_DRAW_HUD;
+	renderer_layer(renderer, renderer->hud.layer);
+
+	if (game.player.life == 0)
+	{
+		if (overlay)
+			profile_draw_overlay(renderer, *overlay);
+		renderer_end(renderer, clear_color);
+		return;
+	}
+
+	renderer->stage = PROFILE_DRAW_ALIENS;
+	size_t current_frame = game_alien_frame(game);
+	for (size_t ai = 0; ai < game.num_aliens; ++ai)
+	{
+		if (game.death_counters[ai] == 0) continue;
+
+		uint8_t type = game.alien_type[ai];
+		if (type == ALIEN_DEAD)
+		{
+			renderer_sprite(renderer, alien_death_sprite, game.alien_x[ai], game.alien_y[ai]);
+		}
+		else
+		{
+			const Sprite& sprite = alien_sprites[2 * (type - 1) + current_frame];
+			renderer_sprite(renderer, sprite, game.alien_x[ai], game.alien_y[ai]);
+		}
+	}
+
+	renderer->stage = PROFILE_DRAW_BULLETS;
+	for (size_t bi = 0; bi < game.num_bullets; ++bi)
+	{
+		//if player bullet
+		if (game.bullet_dir[bi] > 0)
+			renderer_sprite(renderer, player_bullet_sprite, game.bullet_x[bi], game.bullet_y[bi], player_color);
+		else
+			renderer_sprite(renderer, alien_bullet_sprite[game_alien_bullet_frame(game)], game.bullet_x[bi], game.bullet_y[bi], alien_color);
+	}
+	renderer->stage = PROFILE_DRAW_PLAYER;
+	renderer_sprite(renderer, player_sprite, game.player.x, game.player.y, player_color);
+
+	if (overlay)
+		profile_draw_overlay(renderer, *overlay);
+	renderer_end(renderer, clear_color);
+}
+
+static size_t lerp_position(size_t a, size_t b, double alpha)
+{
+	return a + (ptrdiff_t)floor(((double)b - (double)a) * alpha + 0.5);
+}
+
+void game_interpolate(Game& out, const Game& prev, const Game& next, double alpha)
+{
+	out = next;
+	if (alpha >= 1.0) return;
+	if (alpha < 0.0) alpha = 0.0;
+
+	// A bigger jump is a reset, not movement
+	int dx = (int)next.player.x - (int)prev.player.x;
+	if (dx >= -2 && dx <= 2)
+		out.player.x = lerp_position(prev.player.x, next.player.x, alpha);
+
+	// Slots line up unless a bullet was removed or added before this one
+	size_t num_bullets = prev.num_bullets < next.num_bullets ? prev.num_bullets : next.num_bullets;
+	for (size_t bi = 0; bi < num_bullets; ++bi)
+	{
+		if (prev.bullet_x[bi] == next.bullet_x[bi] && prev.bullet_dir[bi] == next.bullet_dir[bi] &&
+			next.bullet_y[bi] - prev.bullet_y[bi] == next.bullet_dir[bi])
+		{
+			out.bullet_y[bi] = (int16_t)lerp_position(prev.bullet_y[bi], next.bullet_y[bi], alpha);
+		}
+	}
+}
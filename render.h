@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "sprites.h"
+#include "game.h"
+#include "profile.h"
+
+struct Buffer
+{
+	size_t width, height;
+	uint32_t* data;
+};
+
+// Rows y to y + height - 1, columns x to x + width - 1
+struct DirtyRect
+{
+	size_t x, y, width, height;
+};
+
+void buffer_clear(Buffer* buffer, uint32_t color);
+
+// Clips once and writes whole rows from the sprite's 1-bit row masks.
+// color == 0 uses the sprite's own color.
+void buffer_draw_sprite(Buffer* buffer, const Sprite& sprite, size_t x, size_t y, uint32_t color = 0);
+
+// Same, but only touches pixels inside clip, which must lie in the buffer
+void buffer_draw_sprite_clipped(Buffer* buffer, const Sprite& sprite, size_t x, size_t y, uint32_t color, const DirtyRect& clip);
+
+// The original per-pixel loop over the byte data, same output. Kept as a
+// reference for benchmarks and for sprites without masks.
+void buffer_draw_sprite_bytes(Buffer* buffer, const Sprite& sprite, size_t x, size_t y, uint32_t color = 0);
+
+void buffer_draw_number(
+	Buffer* buffer,
+	const Sprite& number_spritesheet, size_t number,
+	size_t x, size_t y,
+	uint32_t color);
+
+void buffer_draw_text(
+	Buffer* buffer,
+	const Sprite& text_spritesheet,
+	const char* text,
+	size_t x, size_t y,
+	uint32_t color);
+
+#define RENDER_TILE_SIZE 16
+#define RENDER_MAX_TILES 1024 // Enough for a 512x512 buffer
+#define RENDER_MAX_DRAWS (GAME_MAX_ALIENS + GAME_MAX_BULLETS + 512) // Text, overlay included
+
+// A pre-rasterized image the size of the buffer, 0 where transparent.
+// tile_version[t] changes whenever the pixels in renderer tile t do, so
+// the renderer hashes that instead of the pixels.
+struct Layer
+{
+	Buffer image;
+	uint32_t tile_version[RENDER_MAX_TILES];
+};
+
+// One recorded draw. A NULL sprite.data fills the whole
+// sprite.width x sprite.height rectangle instead. If layer is set the
+// whole layer is copied instead and the rest is ignored.
+struct DrawCommand
+{
+	Sprite sprite;
+	size_t x, y;
+	uint32_t color;
+	const Layer* layer;
+	ProfileStage stage; // What the rasterizing time is charged to
+};
+
+// Score, high score, level, lives and the bottom line. Rasterized into
+// scratch only when one of the values shown changes, then the tiles that
+// differ are copied into the layer.
+struct HudLayer
+{
+	Layer layer;
+	Buffer scratch;
+	bool valid;
+	size_t score, level, life;
+	uint32_t high_score;
+};
+
+// Draws are recorded between renderer_begin and renderer_end. The buffer
+// is split into tiles and renderer_end hashes the draws touching each
+// tile; only tiles whose hash changed are cleared and redrawn. Redrawn
+// tiles pile up until renderer_take_rects turns them into rectangles for
+// the texture upload.
+struct Renderer
+{
+	Buffer* buffer;
+	size_t tiles_x, tiles_y;
+	bool redraw_all;
+	ProfileStage stage; // Stage of the draws recorded from now on
+
+	size_t num_draws;
+	DrawCommand draws[RENDER_MAX_DRAWS];
+
+	uint64_t tile_hash[RENDER_MAX_TILES];
+	bool tile_dirty[RENDER_MAX_TILES];
+	bool tile_pending[RENDER_MAX_TILES];
+
+	size_t num_rects;
+	DirtyRect rects[RENDER_MAX_TILES];
+
+	HudLayer hud;
+};
+
+// The buffer must stay the same size for the renderer's lifetime
+void renderer_init(Renderer* renderer, Buffer* buffer);
+void renderer_free(Renderer* renderer);
+
+void renderer_begin(Renderer* renderer);
+void renderer_sprite(Renderer* renderer, const Sprite& sprite, size_t x, size_t y, uint32_t color = 0);
+void renderer_fill(Renderer* renderer, size_t x, size_t y, size_t width, size_t height, uint32_t color);
+void renderer_number(Renderer* renderer, const Sprite& number_spritesheet, size_t number, size_t x, size_t y, uint32_t color);
+void renderer_text(Renderer* renderer, const Sprite& text_spritesheet, const char* text, size_t x, size_t y, uint32_t color);
+void renderer_layer(Renderer* renderer, const Layer& layer);
+void renderer_end(Renderer* renderer, uint32_t clear_color);
+
+// Rectangles covering every tile redrawn since the last call, in
+// renderer->rects. Returns how many.
+size_t renderer_take_rects(Renderer* renderer);
+
+// Record the HUD, swarm, bullets and player for the current state, and
+// the profiler overlay if one is passed
+void game_draw(Renderer* renderer, const Game& game, const ProfileSummary* overlay = NULL);
+
+// The state alpha of the way from prev to the tick after it, next, for
+// drawing between ticks. Only the player and bullets that survived the
+// tick move smoothly, everything else snaps to next.
+void game_interpolate(Game& out, const Game& prev, const Game& next, double alpha);
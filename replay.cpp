@@ -0,0 +1,209 @@
+#include "replay.h"
+
+static uint8_t replay_pack_input(const Input& input)
+{
+	int move = input.move_dir < 0 ? 0 : (input.move_dir > 0 ? 2 : 1);
+	return (uint8_t)(move | (input.fire << 2) | (input.reset << 3) | (input.game_over << 4));
+}
+
+static Input replay_unpack_input(uint8_t packed)
+{
+	Input input;
+	input.move_dir = int(packed & 3) - 1;
+	input.fire = (packed >> 2) & 1;
+	input.reset = (packed >> 3) & 1;
+	input.game_over = (packed >> 4) & 1;
+	return input;
+}
+
+static void put_u16(uint8_t* p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+	put_u16(p, (uint16_t)v);
+	put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void put_u64(uint8_t* p, uint64_t v)
+{
+	put_u32(p, (uint32_t)v);
+	put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t get_u16(const uint8_t* p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+	return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static uint64_t get_u64(const uint8_t* p)
+{
+	return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static bool replay_write_header(FILE* file, const ReplayHeader& header)
+{
+	uint8_t bytes[REPLAY_HEADER_SIZE];
+	bytes[0] = 'S'; bytes[1] = 'I'; bytes[2] = 'R'; bytes[3] = 'P';
+	put_u32(bytes + 4, REPLAY_VERSION);
+	put_u32(bytes + 8, header.seed);
+	put_u32(bytes + 12, header.high_score);
+	put_u16(bytes + 16, header.width);
+	put_u16(bytes + 18, header.height);
+	put_u64(bytes + 20, header.ticks);
+	put_u64(bytes + 28, header.final_hash);
+	return fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+}
+
+static bool replay_flush_run(ReplayWriter* writer)
+{
+	if (writer->run == 0) return true;
+
+	uint8_t bytes[11];
+	size_t n = 0;
+	bytes[n++] = writer->input;
+	uint64_t run = writer->run;
+	do
+	{
+		uint8_t byte = run & 0x7f;
+		run >>= 7;
+		bytes[n++] = byte | (run ? 0x80 : 0);
+	} while (run);
+
+	writer->run = 0;
+	return fwrite(bytes, 1, n, writer->file) == n;
+}
+
+bool replay_open_write(ReplayWriter* writer, const char* path,
+	size_t width, size_t height, uint32_t seed, uint32_t high_score)
+{
+	writer->file = fopen(path, "wb");
+	if (!writer->file)
+	{
+		fprintf(stderr, "Error: could not create replay %s\n", path);
+		return false;
+	}
+
+	writer->header.seed = seed;
+	writer->header.high_score = high_score;
+	writer->header.width = (uint16_t)width;
+	writer->header.height = (uint16_t)height;
+	writer->header.ticks = 0;
+	writer->header.final_hash = 0;
+	writer->input = 0;
+	writer->run = 0;
+
+	// Patched with the tick count and hash on close
+	return replay_write_header(writer->file, writer->header);
+}
+
+void replay_write_tick(ReplayWriter* writer, const Input& input)
+{
+	uint8_t packed = replay_pack_input(input);
+	if (writer->run > 0 && packed != writer->input)
+		replay_flush_run(writer);
+	writer->input = packed;
+	writer->run++;
+	writer->header.ticks++;
+}
+
+bool replay_close_write(ReplayWriter* writer, const Game& game)
+{
+	writer->header.final_hash = game_hash(game);
+	bool ok = replay_flush_run(writer);
+	ok = ok && fseek(writer->file, 0, SEEK_SET) == 0;
+	ok = ok && replay_write_header(writer->file, writer->header);
+	ok = fclose(writer->file) == 0 && ok;
+	writer->file = NULL;
+	if (!ok)
+		fprintf(stderr, "Error: could not write replay\n");
+	return ok;
+}
+
+bool replay_open_read(ReplayReader* reader, const char* path)
+{
+	reader->data = NULL;
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		fprintf(stderr, "Error: could not open replay %s\n", path);
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size < REPLAY_HEADER_SIZE)
+	{
+		fprintf(stderr, "Error: %s is not a replay\n", path);
+		fclose(file);
+		return false;
+	}
+
+	reader->data = new uint8_t[size];
+	reader->size = fread(reader->data, 1, size, file);
+	fclose(file);
+
+	const uint8_t* p = reader->data;
+	if (reader->size != (size_t)size || p[0] != 'S' || p[1] != 'I' || p[2] != 'R' || p[3] != 'P' ||
+		get_u32(p + 4) != REPLAY_VERSION)
+	{
+		fprintf(stderr, "Error: %s is not a version %d replay\n", path, REPLAY_VERSION);
+		replay_close_read(reader);
+		return false;
+	}
+
+	reader->header.seed = get_u32(p + 8);
+	reader->header.high_score = get_u32(p + 12);
+	reader->header.width = get_u16(p + 16);
+	reader->header.height = get_u16(p + 18);
+	reader->header.ticks = get_u64(p + 20);
+	reader->header.final_hash = get_u64(p + 28);
+	reader->pos = REPLAY_HEADER_SIZE;
+	reader->input = 0;
+	reader->run = 0;
+	reader->ticks = 0;
+	return true;
+}
+
+bool replay_read_tick(ReplayReader* reader, Input* input)
+{
+	if (reader->ticks == reader->header.ticks)
+		return false;
+
+	if (reader->run == 0)
+	{
+		// Next record, a truncated one ends the replay
+		if (reader->pos >= reader->size) return false;
+		reader->input = reader->data[reader->pos++];
+		uint64_t run = 0;
+		for (int shift = 0; ; shift += 7)
+		{
+			if (reader->pos >= reader->size || shift > 63) return false;
+			uint8_t byte = reader->data[reader->pos++];
+			run |= (uint64_t)(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) break;
+		}
+		if (run == 0) return false;
+		reader->run = run;
+	}
+
+	*input = replay_unpack_input(reader->input);
+	reader->run--;
+	reader->ticks++;
+	return true;
+}
+
+void replay_close_read(ReplayReader* reader)
+{
+	delete[] reader->data;
+	reader->data = NULL;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include "game.h"
+
+// Replay files hold everything needed to re-run a game tick for tick:
+//
+//   0  "SIRP"
+//   4  u32 version
+//   8  u32 seed          \ the game_init arguments
+//  12  u32 high score    /
+//  16  u16 width, u16 height
+//  20  u64 ticks
+//  28  u64 game_hash of the final state
+//  36  records until the end of the file
+//
+// All little endian. Each record is one packed input byte followed by
+// how many ticks in a row it held, as an unsigned LEB128 varint, so a
+// player holding a direction costs two or three bytes, not one per tick.
+// Input byte: bits 0-1 move_dir + 1, bit 2 fire, bit 3 reset,
+// bit 4 game_over.
+
+#define REPLAY_VERSION 2 // 2: game_init seeds a PCG32 stream
+#define REPLAY_HEADER_SIZE 36
+
+struct ReplayHeader
+{
+	uint32_t seed;
+	uint32_t high_score;
+	uint16_t width, height;
+	uint64_t ticks;
+	uint64_t final_hash;
+};
+
+struct ReplayWriter
+{
+	FILE* file;
+	ReplayHeader header;
+	uint8_t input;
+	uint64_t run;
+};
+
+struct ReplayReader
+{
+	ReplayHeader header;
+	uint8_t* data;
+	size_t size, pos;
+	uint8_t input;
+	uint64_t run;
+	uint64_t ticks;
+};
+
+// Record a game started with game_init(game, width, height, seed, high_score)
+bool replay_open_write(ReplayWriter* writer, const char* path,
+	size_t width, size_t height, uint32_t seed, uint32_t high_score);
+void replay_write_tick(ReplayWriter* writer, const Input& input);
+// Writes the tick count and the hash of game, which must be the state
+// after the last recorded tick
+bool replay_close_write(ReplayWriter* writer, const Game& game);
+
+bool replay_open_read(ReplayReader* reader, const char* path);
+// Input for the next tick, false once every recorded tick was read
+bool replay_read_tick(ReplayReader* reader, Input* input);
+void replay_close_read(ReplayReader* reader);
@@ -0,0 +1,42 @@
+#include "rng.h"
+
+void rng_seed(Rng* rng, uint64_t seed, uint64_t stream)
+{
+	rng->state = 0;
+	rng->inc = (stream << 1) | 1;
+	rng_next(rng);
+	rng->state += seed;
+	rng_next(rng);
+}
+
+// Brown, "Random Number Generation with Arbitrary Strides": composes the
+// LCG step with itself by squaring, one bit of delta at a time
+void rng_advance(Rng* rng, uint64_t delta)
+{
+	uint64_t cur_mult = RNG_MULTIPLIER;
+	uint64_t cur_plus = rng->inc;
+	uint64_t acc_mult = 1;
+	uint64_t acc_plus = 0;
+	while (delta > 0)
+	{
+		if (delta & 1)
+		{
+			acc_mult *= cur_mult;
+			acc_plus = acc_plus * cur_mult + cur_plus;
+		}
+		cur_plus = (cur_mult + 1) * cur_plus;
+		cur_mult *= cur_mult;
+		delta >>= 1;
+	}
+	rng->state = acc_mult * rng->state + acc_plus;
+}
+
+uint32_t xorshift32(uint32_t* rng)
+{
+	uint32_t x = *rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*rng = x;
+	return x;
+}
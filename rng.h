@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+
+// PCG32 (O'Neill, "PCG: A Family of Simple Fast Space-Efficient
+// Statistically Good Algorithms for Random Number Generation"): 64-bit
+// state, 32-bit output, period 2^64. The increment selects one of 2^63
+// independent streams, and rng_advance jumps any distance in O(log n),
+// so parallel instances can share a seed and still never overlap.
+struct Rng
+{
+	uint64_t state;
+	uint64_t inc; // Always odd
+};
+
+#define RNG_MULTIPLIER 6364136223846793005ull
+// What rng_jump skips: 2^16 instances of 2^48 draws each
+#define RNG_JUMP_DISTANCE (1ull << 48)
+
+void rng_seed(Rng* rng, uint64_t seed, uint64_t stream = 0);
+// Same as drawing delta numbers and throwing them away
+void rng_advance(Rng* rng, uint64_t delta);
+inline void rng_jump(Rng* rng) { rng_advance(rng, RNG_JUMP_DISTANCE); }
+
+inline uint32_t rng_next(Rng* rng)
+{
+	uint64_t old = rng->state;
+	rng->state = old * RNG_MULTIPLIER + rng->inc;
+	uint32_t xorshifted = uint32_t(((old >> 18) ^ old) >> 27);
+	uint32_t rot = uint32_t(old >> 59);
+	return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+}
+
+// Uniform in [0, bound) without modulo bias (Lemire, "Fast Random
+// Integer Generation in an Interval"). Nearly always one draw and one
+// multiply. Returns 0 for a bound of 0.
+inline uint32_t rng_range(Rng* rng, uint32_t bound)
+{
+	uint64_t m = (uint64_t)rng_next(rng) * bound;
+	uint32_t low = uint32_t(m);
+	if (low < bound)
+	{
+		uint32_t threshold = (0u - bound) % bound;
+		while (low < threshold)
+		{
+			m = (uint64_t)rng_next(rng) * bound;
+			low = uint32_t(m);
+		}
+	}
+	return uint32_t(m >> 32);
+}
+
+// Uniform in [lo, hi]
+inline int32_t rng_between(Rng* rng, int32_t lo, int32_t hi)
+{
+	uint32_t span = uint32_t(hi) - uint32_t(lo) + 1;
+	// The full int32 range wraps the span to 0, where every draw fits
+	return int32_t(uint32_t(lo) + (span ? rng_range(rng, span) : rng_next(rng)));
+}
+
+/* Algorithm "xor" from p. 4 of Marsaglia, "Xorshift RNGs". Kept for the
+   scripted input and benchmarks, which only need a cheap 32-bit state. */
+uint32_t xorshift32(uint32_t* rng);
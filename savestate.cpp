@@ -0,0 +1,65 @@
+#include "savestate.h"
+
+void state_ring_init(StateRing* ring, size_t capacity)
+{
+	ring->slots = new Game[capacity];
+	ring->capacity = capacity;
+	ring->head = 0;
+	ring->count = 0;
+}
+
+void state_ring_free(StateRing* ring)
+{
+	delete[] ring->slots;
+	ring->slots = NULL;
+	ring->capacity = ring->count = 0;
+}
+
+void state_ring_push(StateRing* ring, const Game& game)
+{
+	game_save(&ring->slots[ring->head], game);
+	ring->head = (ring->head + 1) % ring->capacity;
+	if (ring->count < ring->capacity)
+		ring->count++;
+}
+
+const Game* state_ring_peek(const StateRing* ring, size_t back)
+{
+	if (back >= ring->count) return NULL;
+	return &ring->slots[(ring->head + ring->capacity - 1 - back) % ring->capacity];
+}
+
+bool state_ring_rewind(StateRing* ring, size_t back, Game& game)
+{
+	const Game* slot = state_ring_peek(ring, back);
+	if (!slot) return false;
+
+	game_restore(game, slot);
+	ring->head = (ring->head + ring->capacity - 1 - back) % ring->capacity;
+	ring->count -= back + 1;
+	return true;
+}
+
+double game_rollouts(const Game& start, size_t num_rollouts, size_t ticks,
+	RolloutPolicy policy, uint32_t seed)
+{
+	if (num_rollouts == 0) return 0.0;
+
+	Game* game = new Game;
+	double total = 0.0;
+	for (size_t i = 0; i < num_rollouts; ++i)
+	{
+		game_restore(*game, &start);
+		uint32_t rng = seed + (uint32_t)i;
+		if (rng == 0) rng = 13;
+		Input input = Input();
+		for (size_t t = 0; t < ticks; ++t)
+		{
+			policy(*game, input, &rng);
+			game_step(*game, input);
+		}
+		total += (double)game->score - (double)start.score;
+	}
+	delete game;
+	return total / num_rollouts;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "game.h"
+
+// Game holds no pointers and every field is fixed size, so the whole
+// state is saved and restored with one memcpy.
+static_assert(std::is_trivially_copyable<Game>::value, "Game must stay memcpy-able for save states");
+
+inline void game_save(Game* slot, const Game& game)
+{
+	memcpy(slot, &game, sizeof(Game));
+}
+
+inline void game_restore(Game& game, const Game* slot)
+{
+	memcpy(&game, slot, sizeof(Game));
+}
+
+// The last `capacity` saved states, oldest overwritten first.
+// Allocated once in state_ring_init.
+struct StateRing
+{
+	Game* slots;
+	size_t capacity;
+	size_t head; // Where the next push goes
+	size_t count;
+};
+
+void state_ring_init(StateRing* ring, size_t capacity);
+void state_ring_free(StateRing* ring);
+
+void state_ring_push(StateRing* ring, const Game& game);
+
+// State saved `back` pushes ago, 0 is the newest. NULL if it was dropped.
+const Game* state_ring_peek(const StateRing* ring, size_t back);
+
+// Restore the state saved `back` pushes ago and drop it along with
+// everything newer, so stepping on from there branches off a new
+// timeline. Returns false and leaves game alone if that state is no
+// longer in the ring.
+bool state_ring_rewind(StateRing* ring, size_t back, Game& game);
+
+// Fills in the input for each tick of a rollout, rng is the rollout's own
+typedef void (*RolloutPolicy)(const Game& game, Input& input, uint32_t* rng);
+
+// Play num_rollouts copies of start for `ticks` ticks each, rollout i
+// driving its input from xorshift32 seed seed + i. start is never
+// touched. Returns the mean score gained.
+double game_rollouts(const Game& start, size_t num_rollouts, size_t ticks,
+	RolloutPolicy policy, uint32_t seed);
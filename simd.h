@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Kernels over the structure-of-arrays swarm in Game and the sprite
+// blitter. The swarm kernels always work on whole vectors of 16 lanes, so
+// n is rounded up and the arrays must be padded to a multiple of SIMD_LANES.
+// The instruction set is picked at compile time: build with -mavx2 for
+// AVX2, x86-64 always has SSE2 and anything else gets the scalar loops.
+
+#define SIMD_LANES 16
+#define SIMD_ROUND_UP(n) (((n) + SIMD_LANES - 1) & ~(size_t)(SIMD_LANES - 1))
+
+// v[i] += delta for every lane
+inline void simd_add_i16(int16_t* v, size_t n, int16_t delta)
+{
+	n = SIMD_ROUND_UP(n);
+#if defined(__AVX2__)
+	__m256i d = _mm256_set1_epi16(delta);
+	for (size_t i = 0; i < n; i += 16)
+	{
+		__m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+		_mm256_storeu_si256((__m256i*)(v + i), _mm256_add_epi16(x, d));
+	}
+#elif defined(__SSE2__)
+	__m128i d = _mm_set1_epi16(delta);
+	for (size_t i = 0; i < n; i += 8)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(v + i));
+		_mm_storeu_si128((__m128i*)(v + i), _mm_add_epi16(x, d));
+	}
+#else
+	for (size_t i = 0; i < n; ++i)
+		v[i] += delta;
+#endif
+}
+
+// dst[i] = color for every bit i set in bits, i < n <= 64. Lanes from n
+// on are never written. AVX2 writes 8 pixels per masked store; SSE2 has
+// no 32-bit masked store and a load/blend/store measured slower than
+// walking the set bits, so everything else takes the scalar loop.
+inline void simd_fill_masked_u32(uint32_t* dst, uint64_t bits, size_t n, uint32_t color)
+{
+	if (n < 64)
+		bits &= (1ull << n) - 1;
+#if defined(__AVX2__)
+	const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	const __m256i c = _mm256_set1_epi32(color);
+	for (size_t i = 0; i < n; i += 8)
+	{
+		__m256i b = _mm256_and_si256(_mm256_set1_epi32((bits >> i) & 0xff), lane_bits);
+		_mm256_maskstore_epi32((int*)(dst + i), _mm256_cmpeq_epi32(b, lane_bits), c);
+	}
+#else
+	while (bits)
+	{
+		dst[__builtin_ctzll(bits)] = color;
+		bits &= bits - 1;
+	}
+#endif
+}
@@ -0,0 +1,220 @@
+#include "sprites.h"
+
+static constexpr uint8_t alien_a0_art[64] =
+{
+	0,0,0,1,1,0,0,0, // ...@@...
+	0,0,1,1,1,1,0,0, // ..@@@@..
+	0,1,1,1,1,1,1,0, // .@@@@@@.
+	1,1,0,1,1,0,1,1, // @@.@@.@@
+	1,1,1,1,1,1,1,1, // @@@@@@@@
+	0,1,0,1,1,0,1,0, // .@.@@.@.
+	1,0,0,0,0,0,0,1, // @......@
+	0,1,0,0,0,0,1,0  // .@....@.
+};
+
+static constexpr uint8_t alien_a1_art[64] =
+{
+	0,0,0,1,1,0,0,0, // ...@@...
+	0,0,1,1,1,1,0,0, // ..@@@@..
+	0,1,1,1,1,1,1,0, // .@@@@@@.
+	1,1,0,1,1,0,1,1, // @@.@@.@@
+	1,1,1,1,1,1,1,1, // @@@@@@@@
+	0,0,1,0,0,1,0,0, // ..@..@..
+	0,1,0,1,1,0,1,0, // .@.@@.@.
+	1,0,1,0,0,1,0,1  // @.@..@.@
+};
+
+static constexpr uint8_t alien_b0_art[88] =
+{
+	0,0,1,0,0,0,0,0,1,0,0, // ..@.....@..
+	0,0,0,1,0,0,0,1,0,0,0, // ...@...@...
+	0,0,1,1,1,1,1,1,1,0,0, // ..@@@@@@@..
+	0,1,1,0,1,1,1,0,1,1,0, // .@@.@@@.@@.
+	1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@
+	1,0,1,1,1,1,1,1,1,0,1, // @.@@@@@@@.@
+	1,0,1,0,0,0,0,0,1,0,1, // @.@.....@.@
+	0,0,0,1,1,0,1,1,0,0,0  // ...@@.@@...
+};
+
+static constexpr uint8_t alien_b1_art[88] =
+{
+	0,0,1,0,0,0,0,0,1,0,0, // ..@.....@..
+	1,0,0,1,0,0,0,1,0,0,1, // @..@...@..@
+	1,0,1,1,1,1,1,1,1,0,1, // @.@@@@@@@.@
+	1,1,1,0,1,1,1,0,1,1,1, // @@@.@@@.@@@
+	1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@
+	0,1,1,1,1,1,1,1,1,1,0, // .@@@@@@@@@.
+	0,0,1,0,0,0,0,0,1,0,0, // ..@.....@..
+	0,1,0,0,0,0,0,0,0,1,0  // .@.......@.
+};
+
+static constexpr uint8_t alien_c0_art[96] =
+{
+	0,0,0,0,1,1,1,1,0,0,0,0, // ....@@@@....
+	0,1,1,1,1,1,1,1,1,1,1,0, // .@@@@@@@@@@.
+	1,1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@@
+	1,1,1,0,0,1,1,0,0,1,1,1, // @@@..@@..@@@
+	1,1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@@
+	0,0,0,1,1,0,0,1,1,0,0,0, // ...@@..@@...
+	0,0,1,1,0,1,1,0,1,1,0,0, // ..@@.@@.@@..
+	1,1,0,0,0,0,0,0,0,0,1,1  // @@........@@
+};
+
+static constexpr uint8_t alien_c1_art[96] =
+{
+	0,0,0,0,1,1,1,1,0,0,0,0, // ....@@@@....
+	0,1,1,1,1,1,1,1,1,1,1,0, // .@@@@@@@@@@.
+	1,1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@@
+	1,1,1,0,0,1,1,0,0,1,1,1, // @@@..@@..@@@
+	1,1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@@
+	0,0,1,1,1,0,0,1,1,1,0,0, // ..@@@..@@@..
+	0,1,1,0,0,1,1,0,0,1,1,0, // .@@..@@..@@.
+	0,0,1,1,0,0,0,0,1,1,0,0  // ..@@....@@..
+};
+
+static constexpr uint8_t alien_death_art[91] =
+{
+	0,1,0,0,1,0,0,0,1,0,0,1,0, // .@..@...@..@.
+	0,0,1,0,0,1,0,1,0,0,1,0,0, // ..@..@.@..@..
+	0,0,0,1,0,0,0,0,0,1,0,0,0, // ...@.....@...
+	1,1,0,0,0,0,0,0,0,0,0,1,1, // @@.........@@
+	0,0,0,1,0,0,0,0,0,1,0,0,0, // ...@.....@...
+	0,0,1,0,0,1,0,1,0,0,1,0,0, // ..@..@.@..@..
+	0,1,0,0,1,0,0,0,1,0,0,1,0  // .@..@...@..@.
+};
+
+static constexpr uint8_t player_art[77] =
+{
+	0,0,0,0,0,1,0,0,0,0,0, // .....@.....
+	0,0,0,0,1,1,1,0,0,0,0, // ....@@@....
+	0,0,0,0,1,1,1,0,0,0,0, // ....@@@....
+	0,1,1,1,1,1,1,1,1,1,0, // .@@@@@@@@@.
+	1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@
+	1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@
+	1,1,1,1,1,1,1,1,1,1,1, // @@@@@@@@@@@
+};
+
+static constexpr uint8_t text_art[65 * 35] =
+{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // ' '
+	0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,0,0,0,0,0,1,0,0, // '!'
+	0,1,0,1,0,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // '"'
+	0,1,0,1,0,0,1,0,1,0,1,1,1,1,1,0,1,0,1,0,1,1,1,1,1,0,1,0,1,0,0,1,0,1,0, // '#'
+	0,0,1,0,0,0,1,1,1,0,1,0,1,0,0,0,1,1,1,0,0,0,1,0,1,0,1,1,1,0,0,0,1,0,0, // '$'
+	1,1,0,1,0,1,1,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,0,1,1,0,1,0,1,1, // '%'
+	0,1,1,0,0,1,0,0,1,0,1,0,0,1,0,0,1,1,0,0,1,0,0,1,0,1,0,0,0,1,0,1,1,1,1, // '&'
+	0,0,0,1,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // '`'
+	0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,1, // '{'
+	1,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0, // '}'
+	0,0,1,0,0,1,0,1,0,1,0,1,1,1,0,0,0,1,0,0,0,1,1,1,0,1,0,1,0,1,0,0,1,0,0, // '*'
+	0,0,0,0,0,0,0,1,0,0,0,0,1,0,0,1,1,1,1,1,0,0,1,0,0,0,0,1,0,0,0,0,0,0,0, // '+'
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,1,0,0, // ','
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // '-'
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0, // '.'
+	0,0,0,1,0,0,0,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,0,0,0,0,1,0,0,0, // '/'
+
+	0,1,1,1,0,1,0,0,0,1,1,0,0,1,1,1,0,1,0,1,1,1,0,0,1,1,0,0,0,1,0,1,1,1,0, // '0'
+	0,0,1,0,0,0,1,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,1,1,0, // '1'
+	0,1,1,1,0,1,0,0,0,1,0,0,0,0,1,0,0,1,1,0,0,1,0,0,0,1,0,0,0,0,1,1,1,1,1, // '2'
+	1,1,1,1,1,0,0,0,0,1,0,0,0,1,0,0,0,1,1,0,0,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // '3'
+	0,0,0,1,0,0,0,1,1,0,0,1,0,1,0,1,0,0,1,0,1,1,1,1,1,0,0,0,1,0,0,0,0,1,0, // '4'
+	1,1,1,1,1,1,0,0,0,0,1,1,1,1,0,0,0,0,0,1,0,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // '5'
+	0,1,1,1,0,1,0,0,0,1,1,0,0,0,0,1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // '6'
+	1,1,1,1,1,0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0, // '7'
+	0,1,1,1,0,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // '8'
+	0,1,1,1,0,1,0,0,0,1,1,0,0,0,1,0,1,1,1,1,0,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // '9'
+
+	0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0, // ':'
+	0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,1,0,0, // ';'
+	0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,1, // '<'
+	0,0,0,0,0,0,0,0,0,0,1,1,1,1,1,0,0,0,0,0,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0, // '='
+	1,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0, // '>'
+	0,1,1,1,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,0,0,0,0,0,1,0,0, // '?'
+	0,1,1,1,0,1,0,0,0,1,1,0,1,0,1,1,1,0,1,1,1,0,1,0,0,1,0,0,0,1,0,1,1,1,0, // '@'
+
+	0,0,1,0,0,0,1,0,1,0,1,0,0,0,1,1,0,0,0,1,1,1,1,1,1,1,0,0,0,1,1,0,0,0,1, // 'A'
+	1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,1,1,1,0, // 'B'
+	0,1,1,1,0,1,0,0,0,1,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,0,1,1,1,0, // 'C'
+	1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,1,1,1,0, // 'D'
+	1,1,1,1,1,1,0,0,0,0,1,0,0,0,0,1,1,1,1,0,1,0,0,0,0,1,0,0,0,0,1,1,1,1,1, // 'E'
+	1,1,1,1,1,1,0,0,0,0,1,0,0,0,0,1,1,1,1,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0, // 'F'
+	0,1,1,1,0,1,0,0,0,1,1,0,0,0,0,1,0,1,1,1,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // 'G'
+	1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,1,1,1,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1, // 'H'
+	0,1,1,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,1,1,1,0, // 'I'
+	0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // 'J'
+	1,0,0,0,1,1,0,0,1,0,1,0,1,0,0,1,1,0,0,0,1,0,1,0,0,1,0,0,1,0,1,0,0,0,1, // 'K'
+	1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,1,1,1,1, // 'L'
+	1,0,0,0,1,1,1,0,1,1,1,0,1,0,1,1,0,1,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1, // 'M'
+	1,0,0,0,1,1,0,0,0,1,1,1,0,0,1,1,0,1,0,1,1,0,0,1,1,1,0,0,0,1,1,0,0,0,1, // 'N'
+	0,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // 'O'
+	1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,1,1,1,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0, // 'P'
+	0,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,1,0,1,1,0,0,1,1,0,1,1,1,1, // 'Q'
+	1,1,1,1,0,1,0,0,0,1,1,0,0,0,1,1,1,1,1,0,1,0,1,0,0,1,0,0,1,0,1,0,0,0,1, // 'R'
+	0,1,1,1,0,1,0,0,0,1,1,0,0,0,0,0,1,1,1,0,0,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // 'S'
+	1,1,1,1,1,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0, // 'T'
+	1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,0,1,1,1,0, // 'U'
+	1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,0,1,0,1,0,0,0,1,0,0, // 'V'
+	1,0,0,0,1,1,0,0,0,1,1,0,0,0,1,1,0,1,0,1,1,0,1,0,1,1,1,0,1,1,1,0,0,0,1, // 'W'
+	1,0,0,0,1,1,0,0,0,1,0,1,0,1,0,0,0,1,0,0,0,1,0,1,0,1,0,0,0,1,1,0,0,0,1, // 'X'
+	1,0,0,0,1,1,0,0,0,1,0,1,0,1,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0, // 'Y'
+	1,1,1,1,1,0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,1,1,1,1,1, // 'Z'
+
+	0,0,0,1,1,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,0,1,1, // ']'
+	0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0, // '\'
+	1,1,0,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,1,1,0,0,0, // ']'
+	0,0,1,0,0,0,1,0,1,0,1,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // '^'
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,1, // '_'
+	0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0  // '''
+};
+
+static constexpr uint8_t player_bullet_art[3] =
+{
+	1, 1, 1
+};
+
+static constexpr uint8_t alien_bullet0_art[21] =
+{
+	0,1,0,1,0,0,0,1,0,0,0,1,0,1,0,1,0,0,0,1,0,
+};
+
+static constexpr uint8_t alien_bullet1_art[21] =
+{
+	0,1,0,0,0,1,0,1,0,1,0,0,0,1,0,0,0,1,0,1,0,
+};
+
+static constexpr SpriteSheet<8, 8> alien_a0 = sprite_sheet<8, 8>(alien_a0_art);
+static constexpr SpriteSheet<8, 8> alien_a1 = sprite_sheet<8, 8>(alien_a1_art);
+static constexpr SpriteSheet<11, 8> alien_b0 = sprite_sheet<11, 8>(alien_b0_art);
+static constexpr SpriteSheet<11, 8> alien_b1 = sprite_sheet<11, 8>(alien_b1_art);
+static constexpr SpriteSheet<12, 8> alien_c0 = sprite_sheet<12, 8>(alien_c0_art);
+static constexpr SpriteSheet<12, 8> alien_c1 = sprite_sheet<12, 8>(alien_c1_art);
+static constexpr SpriteSheet<13, 7> alien_death = sprite_sheet<13, 7>(alien_death_art);
+static constexpr SpriteSheet<11, 7> player = sprite_sheet<11, 7>(player_art);
+static constexpr SpriteSheet<5, 7, 65> text = sprite_sheet<5, 7, 65>(text_art);
+static constexpr SpriteSheet<1, 3> player_bullet = sprite_sheet<1, 3>(player_bullet_art);
+static constexpr SpriteSheet<3, 7> alien_bullet0 = sprite_sheet<3, 7>(alien_bullet0_art);
+static constexpr SpriteSheet<3, 7> alien_bullet1 = sprite_sheet<3, 7>(alien_bullet1_art);
+
+constexpr Sprite alien_sprites[6] =
+{
+	sheet_sprite(alien_a0, rgb_to_uint32(255, 154, 0)),
+	sheet_sprite(alien_a1, rgb_to_uint32(255, 154, 0)),
+	sheet_sprite(alien_b0, rgb_to_uint32(0, 120, 255)),
+	sheet_sprite(alien_b1, rgb_to_uint32(0, 120, 255)),
+	sheet_sprite(alien_c0, rgb_to_uint32(189, 0, 255)),
+	sheet_sprite(alien_c1, rgb_to_uint32(189, 0, 255))
+};
+
+constexpr Sprite alien_death_sprite = sheet_sprite(alien_death, rgb_to_uint32(255, 0, 0));
+constexpr Sprite player_sprite = sheet_sprite(player);
+
+// Glyph i is frame i, the digits start at glyph 16
+constexpr Sprite text_spritesheet = sheet_sprite(text);
+constexpr Sprite number_spritesheet = sheet_sprite(text, 0, 16);
+
+constexpr Sprite player_bullet_sprite = sheet_sprite(player_bullet);
+constexpr Sprite alien_bullet_sprite[2] =
+{
+	sheet_sprite(alien_bullet0),
+	sheet_sprite(alien_bullet1)
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+struct Sprite
+{
+	size_t width, height;
+	uint32_t color;
+	const uint8_t* data;
+	// One bit per pixel, row-major: one mask per row of data with bit xi
+	// set for a lit pixel in column xi. Used for collisions and drawing.
+	// May be NULL for sprites built at runtime, which then fall back to data.
+	const uint64_t* masks;
+};
+
+constexpr uint32_t rgb_to_uint32(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255)
+{
+	return ((uint32_t)r << 24) | ((uint32_t)g << 16) | ((uint32_t)b << 8) | a;
+}
+
+// N frames of W x H pixels, with the row masks worked out by the compiler.
+// The game's sprites are all built from these at compile time, so they
+// live in read-only data and nothing is allocated or computed at startup.
+template <size_t W, size_t H, size_t N = 1>
+struct SpriteSheet
+{
+	static constexpr size_t width = W;
+	static constexpr size_t height = H;
+	static constexpr size_t frames = N;
+	uint8_t data[W * H * N];
+	uint64_t masks[H * N];
+};
+
+// From pixel art with one byte per pixel, top row first
+template <size_t W, size_t H, size_t N = 1>
+constexpr SpriteSheet<W, H, N> sprite_sheet(const uint8_t (&art)[W * H * N])
+{
+	static_assert(W <= 64, "Row masks hold at most 64 pixels");
+	SpriteSheet<W, H, N> sheet = {};
+	for (size_t i = 0; i < W * H * N; ++i)
+	{
+		sheet.data[i] = art[i];
+		if (art[i])
+			sheet.masks[i / W] |= uint64_t(1) << (i % W);
+	}
+	return sheet;
+}
+
+// Frame `frame` of a sheet and all the frames after it
+template <size_t W, size_t H, size_t N>
+constexpr Sprite sheet_sprite(const SpriteSheet<W, H, N>& sheet, uint32_t color = 0, size_t frame = 0)
+{
+	return Sprite{ W, H, color, sheet.data + frame * W * H, sheet.masks + frame * H };
+}
+
+inline bool sprite_overlap_check(
+	const Sprite& sp_a, size_t x_a, size_t y_a,
+	const Sprite& sp_b, size_t x_b, size_t y_b
+)
+{
+	if (!(x_a < x_b + sp_b.width && x_a + sp_a.width > x_b &&
+		y_a < y_b + sp_b.height && y_a + sp_a.height > y_b))
+	{
+		return false;
+	}
+
+	if (!sp_a.masks || !sp_b.masks)
+		return true;
+
+	// The rectangles overlap, check the shared rows pixel by pixel. Data
+	// row 0 is the top of the sprite, drawn at y + height - 1.
+	size_t y_lo = y_a > y_b ? y_a : y_b;
+	size_t y_hi = (y_a + sp_a.height < y_b + sp_b.height) ? y_a + sp_a.height : y_b + sp_b.height;
+	for (size_t y = y_lo; y < y_hi; ++y)
+	{
+		uint64_t row_a = sp_a.masks[sp_a.height - 1 - (y - y_a)];
+		uint64_t row_b = sp_b.masks[sp_b.height - 1 - (y - y_b)];
+		if (x_b >= x_a)
+			row_b <<= x_b - x_a;
+		else
+			row_a <<= x_a - x_b;
+		if (row_a & row_b)
+			return true;
+	}
+
+	return false;
+}
+
+// Two animation frames per alien type: A (top row), B, C (bottom rows)
+extern const Sprite alien_sprites[6];
+extern const Sprite alien_death_sprite;
+extern const Sprite player_sprite;
+extern const Sprite text_spritesheet;
+extern const Sprite number_spritesheet;
+extern const Sprite player_bullet_sprite;
+extern const Sprite alien_bullet_sprite[2];
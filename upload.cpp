@@ -0,0 +1,112 @@
+#ifndef HEADLESS
+#include <cstring>
+#include "upload.h"
+
+void upload_init(TextureUpload* upload, const Buffer& buffer)
+{
+	upload->width = buffer.width;
+	upload->height = buffer.height;
+	upload->pbo = 0;
+	upload->mapped = NULL;
+	upload->region = 0;
+	for (size_t i = 0; i < UPLOAD_RING_SIZE; ++i)
+		upload->fences[i] = 0;
+
+	// Same layout as the uploads, so the driver never converts
+	glGenTextures(1, &upload->texture);
+	glBindTexture(GL_TEXTURE_2D, upload->texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, buffer.width, buffer.height, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, buffer.data);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	if (!GLEW_ARB_buffer_storage && !GLEW_VERSION_4_4)
+		return;
+
+	GLsizeiptr size = GLsizeiptr(UPLOAD_RING_SIZE * buffer.width * buffer.height * sizeof(uint32_t));
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &upload->pbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->pbo);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+	upload->mapped = (uint32_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (!upload->mapped)
+	{
+		glDeleteBuffers(1, &upload->pbo);
+		upload->pbo = 0;
+	}
+}
+
+void upload_rects(TextureUpload* upload, const Buffer& buffer, const DirtyRect* rects, size_t num_rects)
+{
+	if (num_rects == 0)
+		return;
+
+	if (!upload->pbo)
+	{
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, buffer.width);
+		for (size_t i = 0; i < num_rects; ++i)
+		{
+			const DirtyRect& rect = rects[i];
+			glTexSubImage2D(
+				GL_TEXTURE_2D, 0, rect.x, rect.y,
+				rect.width, rect.height,
+				GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,
+				buffer.data + rect.y * buffer.width + rect.x
+			);
+		}
+		return;
+	}
+
+	// Wait until the GPU is done with the region written three frames ago,
+	// usually long since
+	size_t r = upload->region;
+	if (upload->fences[r])
+	{
+		glClientWaitSync(upload->fences[r], GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+		glDeleteSync(upload->fences[r]);
+		upload->fences[r] = 0;
+	}
+
+	// Rectangles are packed back to back; they never overlap, so they
+	// always fit in one region
+	size_t region_start = r * upload->width * upload->height;
+	size_t offset = region_start;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->pbo);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	for (size_t i = 0; i < num_rects; ++i)
+	{
+		const DirtyRect& rect = rects[i];
+		uint32_t* dst = upload->mapped + offset;
+		for (size_t y = 0; y < rect.height; ++y)
+			memcpy(dst + y * rect.width, buffer.data + (rect.y + y) * buffer.width + rect.x, rect.width * sizeof(uint32_t));
+		glTexSubImage2D(
+			GL_TEXTURE_2D, 0, rect.x, rect.y,
+			rect.width, rect.height,
+			GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,
+			(const void*)(offset * sizeof(uint32_t))
+		);
+		offset += rect.width * rect.height;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	upload->fences[r] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	upload->region = (r + 1) % UPLOAD_RING_SIZE;
+}
+
+void upload_free(TextureUpload* upload)
+{
+	for (size_t i = 0; i < UPLOAD_RING_SIZE; ++i)
+		if (upload->fences[i])
+			glDeleteSync(upload->fences[i]);
+	if (upload->pbo)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->pbo);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &upload->pbo);
+	}
+	glDeleteTextures(1, &upload->texture);
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+#ifndef HEADLESS
+#include <cstddef>
+#include <cstdint>
+#include <GL/glew.h>
+#include "render.h"
+
+// Streams the renderer's dirty rectangles into the display texture.
+//
+// With ARB_buffer_storage (GL 4.4) a ring of UPLOAD_RING_SIZE pixel
+// buffer regions stays mapped for the lifetime of the program. Each frame
+// packs its dirty rectangles into the next region and uploads from there,
+// so glTexSubImage2D returns at once and the copy into the texture runs
+// on the GPU. A fence per region keeps the CPU from overwriting pixels
+// the GPU has not read yet. Without the extension it falls back to
+// uploading straight from the buffer.
+#define UPLOAD_RING_SIZE 3
+
+struct TextureUpload
+{
+	GLuint texture;
+	size_t width, height;
+	GLuint pbo; // 0 on the fallback path
+	uint32_t* mapped; // UPLOAD_RING_SIZE regions of width * height pixels
+	GLsync fences[UPLOAD_RING_SIZE];
+	size_t region;
+};
+
+// Creates an RGBA8 texture matching the buffer, bound to the current unit
+void upload_init(TextureUpload* upload, const Buffer& buffer);
+void upload_rects(TextureUpload* upload, const Buffer& buffer, const DirtyRect* rects, size_t num_rects);
+void upload_free(TextureUpload* upload);
+#endif